@@ -0,0 +1,327 @@
+// --- Анимация по траектории камеры ---
+// Использование: animate путь.txt [--size WxH] [--fps N] [--engine подстрока]
+//                        [--workers N] [--color poly|hsv|smooth] [--level 0..9]
+//                        [--out каталог | --pipe "команда"]
+//                        [--start-frame N] [--resume] [--aa 4|16] [--cache-mb N]
+//                        [--tile-store каталог] [--formula формула]
+// Траектория — ключевые кадры с интерполяцией (camera_path.h). Кадры
+// независимы, поэтому раздаются целиком пулу вычислителей: по потоку на
+// каждое устройство (OpenCL в double и CPU), кто освободился — берёт
+// следующий кадр.
+// Вывод — frame_000000.png, ... в каталог (файл появляется под своим
+// именем только дописанным, так что --resume после обрыва пропускает
+// готовые кадры) или сырые кадры rgb24 по порядку в stdin внешнего
+// кодировщика, например:
+//   --pipe "ffmpeg -f rawvideo -pix_fmt rgb24 -s 1280x720 -r 30 -i - out.mp4"
+// С --pipe продолжить оборванный прогон можно с --start-frame N в новый
+// файл и склеить.
+// --aa — адаптивное сглаживание (antialias.h) до 4 или 16 отсчётов на
+// пиксель: меньше мерцания границ от кадра к кадру.
+// --formula — формула итераций (formula.h): mandelbrot (по умолчанию),
+// julia:X,Y, multibrot:N или burning-ship.
+// --cache-mb — считать через общий для всех потоков кэш плиток на N МБ
+// (CachedEngine): соседние кадры медленного пролёта делят большую часть
+// плиток. Кэш хранит только итерации, поэтому без --color smooth и --aa.
+// --tile-store — плитки кэша дополнительно сохраняются на диск (TileStore):
+// повторный прогон траектории берёт их оттуда; только вместе с --cache-mb.
+#include "antialias.h"
+#include "cached_engine.h"
+#include "camera_path.h"
+#include "engine.h"
+#include "formula.h"
+#include "palette.h"
+#include "png_writer.h"
+#include "tile_store.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Сколько кадров может обогнать ещё не записанный в pipe (память на очередь)
+const int PIPE_WINDOW = 16;
+
+struct Options {
+    std::string path;
+    int width = 1280;
+    int height = 720;
+    double fps = 30;
+    std::string engineFilter;
+    int workers = 0;  // 0 — все подходящие вычислители
+    ColorMode colorMode = COLOR_POLY;
+    int level = 1;
+    std::string out = "frames";
+    std::string pipe;
+    int startFrame = 0;
+    bool resume = false;
+    int aaSamples = 1;
+    size_t cacheMb = 0;  // 0 — без кэша плиток
+    std::string tileStore;
+    Formula formula;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg[0] != '-' && options.path.empty()) {
+            options.path = arg;
+            continue;
+        }
+        if (std::strcmp(arg, "--resume") == 0) {
+            options.resume = true;
+            continue;
+        }
+        if (!value) return false;
+        if (std::strcmp(arg, "--size") == 0) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2) return false;
+        } else if (std::strcmp(arg, "--fps") == 0) {
+            options.fps = std::atof(value);
+        } else if (std::strcmp(arg, "--engine") == 0) {
+            options.engineFilter = value;
+        } else if (std::strcmp(arg, "--workers") == 0) {
+            options.workers = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--color") == 0) {
+            if (std::strcmp(value, "poly") == 0) options.colorMode = COLOR_POLY;
+            else if (std::strcmp(value, "hsv") == 0) options.colorMode = COLOR_HSV;
+            else if (std::strcmp(value, "smooth") == 0) options.colorMode = COLOR_SMOOTH;
+            else return false;
+        } else if (std::strcmp(arg, "--level") == 0) {
+            options.level = std::atoi(value);
+            if (options.level < 0 || options.level > 9) return false;
+        } else if (std::strcmp(arg, "--out") == 0) {
+            options.out = value;
+        } else if (std::strcmp(arg, "--pipe") == 0) {
+            options.pipe = value;
+        } else if (std::strcmp(arg, "--start-frame") == 0) {
+            options.startFrame = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--aa") == 0) {
+            options.aaSamples = std::atoi(value);
+            if (options.aaSamples != 4 && options.aaSamples != 16) return false;
+        } else if (std::strcmp(arg, "--cache-mb") == 0) {
+            options.cacheMb = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--tile-store") == 0) {
+            options.tileStore = value;
+        } else if (std::strcmp(arg, "--formula") == 0) {
+            if (!parseFormula(value, options.formula)) return false;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    if (!options.tileStore.empty() && options.cacheMb == 0) return false;
+    if (options.cacheMb > 0 && (options.colorMode == COLOR_SMOOTH || options.aaSamples > 1)) return false;
+    return !options.path.empty() && options.width > 0 && options.height > 0 && options.fps > 0;
+}
+
+// --- Запись кадров в pipe строго по порядку ---
+// Кадры приходят от потоков вразнобой; ушедший вперёд поток ждёт, пока
+// отставание не сократится до PIPE_WINDOW.
+class OrderedPipe {
+public:
+    OrderedPipe(FILE *pipe, int firstFrame) : pipe_(pipe), next_(firstFrame) {}
+
+    bool write(int frame, std::vector<uint8_t> rgb) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return failed_ || frame - next_ < PIPE_WINDOW; });
+        pending_[frame] = std::move(rgb);
+        while (!failed_ && !pending_.empty() && pending_.begin()->first == next_) {
+            const std::vector<uint8_t> &data = pending_.begin()->second;
+            failed_ = std::fwrite(data.data(), 1, data.size(), pipe_) != data.size();
+            pending_.erase(pending_.begin());
+            next_++;
+        }
+        changed_.notify_all();
+        return !failed_;
+    }
+
+    // Кадр не будет записан никогда: ждущие потоки выходят
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = true;
+        changed_.notify_all();
+    }
+
+private:
+    FILE *pipe_;
+    int next_;
+    std::map<int, std::vector<uint8_t>> pending_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool failed_ = false;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: animate path.txt [--size WxH] [--fps N] [--engine substr] [--workers N]"
+                     " [--color poly|hsv|smooth] [--level 0..9] [--out dir | --pipe command] [--start-frame N]"
+                     " [--resume] [--aa 4|16] [--cache-mb N] [--tile-store dir]"
+                     " [--formula mandelbrot|julia:X,Y|multibrot:N|burning-ship]"
+                  << std::endl;
+        return 2;
+    }
+    std::vector<PathKey> keys;
+    std::string error;
+    if (!loadPath(options.path, keys, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    int frames = (int)std::floor((keys.back().time - keys.front().time) * options.fps) + 1;
+
+    // По вычислителю на устройство: float-варианты тех же устройств не берём
+    std::vector<std::unique_ptr<Engine>> engines;
+    for (auto &engine : createEngines()) {
+        if (engine->precision() != PRECISION_DOUBLE) continue;
+        if (engine->name().find(options.engineFilter) == std::string::npos) continue;
+        if (options.workers > 0 && (int)engines.size() >= options.workers) break;
+        engines.push_back(std::move(engine));
+    }
+    if (engines.empty()) {
+        std::cerr << "no engine matches '" << options.engineFilter << "'" << std::endl;
+        return 1;
+    }
+    for (auto &engine : engines) {
+        engine->setSmooth(options.colorMode == COLOR_SMOOTH);
+        engine->setFormula(options.formula);
+    }
+    std::shared_ptr<TileStore> store;
+    if (!options.tileStore.empty()) {
+        store = std::make_shared<TileStore>(options.tileStore);
+        if (!store->ready()) {
+            std::cerr << "cannot open tile store " << options.tileStore << std::endl;
+            return 1;
+        }
+    }
+    std::shared_ptr<TileCache> cache;
+    if (options.cacheMb > 0) {
+        cache = std::make_shared<TileCache>(options.cacheMb << 20);
+        cache->setStore(store);
+        for (auto &engine : engines) engine = std::make_unique<CachedEngine>(std::move(engine), cache);
+    }
+
+    FILE *pipe = nullptr;
+    if (!options.pipe.empty()) {
+        // Кодировщик может упасть: ошибка записи вместо SIGPIPE
+        std::signal(SIGPIPE, SIG_IGN);
+        pipe = popen(options.pipe.c_str(), "w");
+        if (!pipe) {
+            std::cerr << "cannot run " << options.pipe << std::endl;
+            return 1;
+        }
+    } else {
+        std::error_code ec;
+        std::filesystem::create_directories(options.out, ec);
+    }
+    OrderedPipe ordered(pipe, options.startFrame);
+
+    std::fprintf(stderr, "%d frames %dx%d of %s from %zu keyframes on %zu workers\n", frames, options.width,
+                 options.height, formulaName(options.formula).c_str(), keys.size(), engines.size());
+    for (auto &engine : engines) std::fprintf(stderr, "  %s\n", engine->name().c_str());
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<int> nextFrame{options.startFrame};
+    std::atomic<int> done{0}, skipped{0};
+    std::atomic<bool> failed{false};
+    std::vector<int> perWorker(engines.size());
+
+    auto work = [&](size_t worker) {
+        traceSetThreadName("animate worker");
+        Engine &engine = *engines[worker];
+        IterationBuffer buffer;
+        std::vector<uint8_t> smoothed;
+        AntialiasOptions aa;
+        aa.maxSamples = options.aaSamples;
+        aa.colorMode = options.colorMode;
+        AntialiasStats aaStats;
+        for (int frame = nextFrame++; frame < frames && !failed; frame = nextFrame++) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06d.png", frame);
+            std::filesystem::path file = std::filesystem::path(options.out) / name;
+            if (!pipe && options.resume && std::filesystem::exists(file)) {
+                skipped++;
+                continue;
+            }
+
+            View view = pathView(keys, keys.front().time + frame / options.fps);
+            view.width = options.width;
+            view.height = options.height;
+            bool rendered = options.aaSamples > 1 ? renderAntialiased(engine, view, aa, smoothed, aaStats)
+                                                  : engine.render(view, buffer);
+            if (!rendered) {
+                std::cerr << engine.name() << ": render failed on frame " << frame << std::endl;
+                failed = true;
+                ordered.abort();
+                break;
+            }
+            // Строки буфера идут снизу вверх, кадр — сверху вниз
+            std::vector<uint8_t> rgb((size_t)view.width * view.height * 3);
+            size_t rowBytes = (size_t)view.width * 3;
+            for (int r = 0; r < view.height && options.aaSamples > 1; r++)
+                std::copy_n(&smoothed[(view.height - 1 - r) * rowBytes], rowBytes, &rgb[r * rowBytes]);
+            for (int r = 0; r < view.height && options.aaSamples == 1; r++) {
+                size_t offset = (size_t)(view.height - 1 - r) * view.width;
+                uint8_t *out = &rgb[(size_t)r * view.width * 3];
+                if (buffer.smooth.empty())
+                    colorizeRow(&buffer.iter[offset], view.width, view.maxIter, options.colorMode, out);
+                else
+                    colorizeRow(&buffer.smooth[offset], view.width, view.maxIter, options.colorMode, out);
+            }
+
+            bool ok;
+            if (pipe) {
+                ok = ordered.write(frame, std::move(rgb));
+            } else {
+                // Под временным именем, потом rename: оборванный кадр не
+                // примется за готовый при --resume
+                std::filesystem::path partial = file;
+                partial += ".part";
+                PngWriter png;
+                ok = png.open(partial.string(), view.width, view.height, options.level, 1) &&
+                     png.writeRows(rgb.data(), view.height) && png.close();
+                std::error_code ec;
+                if (ok) std::filesystem::rename(partial, file, ec);
+                ok = ok && !ec;
+            }
+            if (!ok) {
+                std::cerr << "cannot write frame " << frame << std::endl;
+                failed = true;
+                ordered.abort();
+                break;
+            }
+            perWorker[worker]++;
+            int count = ++done;
+            if (count % 10 == 0) std::fprintf(stderr, "\rframe %d/%d", count + skipped, frames - options.startFrame);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < engines.size(); i++) pool.emplace_back(work, i);
+    work(0);
+    for (std::thread &thread : pool) thread.join();
+    if (pipe && pclose(pipe) != 0) failed = true;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "\n%d frames rendered, %d already present, %.1f s, %.2f frames/s\n", done.load(),
+                 skipped.load(), seconds, done / seconds);
+    for (size_t i = 0; i < engines.size(); i++)
+        std::fprintf(stderr, "  %5d  %s\n", perWorker[i], engines[i]->name().c_str());
+    if (cache) printTileCacheStats(*cache);
+    if (store) printTileStoreStats(*store);
+    return failed ? 1 : 0;
+}
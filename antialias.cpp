@@ -0,0 +1,157 @@
+#include "antialias.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+
+// Порядок заполнения страт 4x4 — матрица Байера: первые 4 отсчёта лежат по
+// одному в каждой четверти пикселя, первые 16 покрывают все страты
+const int STRATA = 4;
+const int BAYER[STRATA][STRATA] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+const int PASS_END[] = {4, 16};  // сколько страт заполнено после каждого прохода
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Дробь [0, 1) из хэша пикселя и номера отсчёта
+float jitter(uint32_t x, uint32_t y, uint32_t k) {
+    uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ k * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return (h >> 8) * (1.0f / (1 << 24));
+}
+
+Rgb sampleColor(uint32_t iter, float smooth, int maxIter, ColorMode mode) {
+    // Для остальных палитр дробная часть не нужна, а её целая часть может
+    // разойтись с iter на единицу
+    return mode == COLOR_SMOOTH ? smoothColor(smooth, maxIter) : colorize(iter, maxIter, mode);
+}
+
+struct PixelSum {
+    uint32_t r = 0, g = 0, b = 0;
+    uint16_t count = 0;
+    uint8_t min[3] = {255, 255, 255}, max[3] = {0, 0, 0};
+
+    void add(const Rgb &c) {
+        r += c.r;
+        g += c.g;
+        b += c.b;
+        count++;
+        const uint8_t v[3] = {c.r, c.g, c.b};
+        for (int i = 0; i < 3; i++) {
+            min[i] = std::min(min[i], v[i]);
+            max[i] = std::max(max[i], v[i]);
+        }
+    }
+    int spread() const { return std::max({max[0] - min[0], max[1] - min[1], max[2] - min[2]}); }
+};
+
+int colorDistance(const Rgb &a, const Rgb &b) {
+    return std::max({std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b)});
+}
+
+}  // namespace
+
+bool renderAntialiased(Engine &engine, const View &view, const AntialiasOptions &options, std::vector<uint8_t> &rgb,
+                       AntialiasStats &stats) {
+    TRACE_SPAN("antialias");
+    int w = view.width, h = view.height;
+    size_t pixels = (size_t)w * h;
+    stats = AntialiasStats();
+    stats.pixels = pixels;
+
+    // --- Основной кадр: отсчёт в центре пикселя ---
+    auto start = std::chrono::steady_clock::now();
+    // smooth и distance нужны только основному кадру; потом — как было
+    bool wasSmooth = engine.smooth(), wasDistance = engine.distance();
+    engine.setSmooth(options.colorMode == COLOR_SMOOTH);
+    engine.setDistance(options.useDistance);
+    IterationBuffer base;
+    bool rendered = engine.render(view, base);
+    engine.setSmooth(wasSmooth);
+    engine.setDistance(wasDistance);
+    if (!rendered) return false;
+    std::vector<Rgb> color(pixels);
+    std::vector<PixelSum> sums(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        color[i] = sampleColor(base.iter[i], base.smooth.empty() ? 0.0f : base.smooth[i], view.maxIter,
+                               options.colorMode);
+        sums[i].add(color[i]);
+    }
+    stats.samples = pixels;
+    stats.baseMs = msSince(start);
+
+    // --- Пиксели на границах ---
+    std::vector<uint32_t> todo;
+    if (options.maxSamples > 1) {
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                size_t i = (size_t)y * w + x;
+                bool edge = !base.distance.empty() && base.iter[i] < (uint32_t)view.maxIter && base.distance[i] < 1.0f;
+                if (x > 0) edge = edge || colorDistance(color[i], color[i - 1]) > options.threshold;
+                if (x + 1 < w) edge = edge || colorDistance(color[i], color[i + 1]) > options.threshold;
+                if (y > 0) edge = edge || colorDistance(color[i], color[i - w]) > options.threshold;
+                if (y + 1 < h) edge = edge || colorDistance(color[i], color[i + w]) > options.threshold;
+                if (edge) todo.push_back((uint32_t)i);
+            }
+        }
+    }
+
+    // --- Проходы уточнения ---
+    start = std::chrono::steady_clock::now();
+    double scale = view.zoom / view.height;
+    std::vector<double> points;
+    std::vector<uint32_t> iter;
+    std::vector<float> smooth;
+    int firstStratum = 0;
+    for (int pass = 0; pass < 2 && !todo.empty() && PASS_END[pass] <= options.maxSamples; pass++) {
+        int lastStratum = PASS_END[pass];
+        int perPixel = lastStratum - firstStratum;
+        points.clear();
+        points.reserve(todo.size() * perPixel * 2);
+        for (uint32_t i : todo) {
+            int x = i % w, y = i / w;
+            for (int sy = 0; sy < STRATA; sy++) {
+                for (int sx = 0; sx < STRATA; sx++) {
+                    int k = BAYER[sy][sx];
+                    if (k < firstStratum || k >= lastStratum) continue;
+                    // Пиксель x — отрезок [x - 0.5, x + 0.5) вокруг центра
+                    double ox = (sx + jitter(x, y, 2 * k)) / STRATA - 0.5;
+                    double oy = (sy + jitter(x, y, 2 * k + 1)) / STRATA - 0.5;
+                    points.push_back(view.centerX + (x + ox - w / 2.0) * scale);
+                    points.push_back(view.centerY + (y + oy - h / 2.0) * scale);
+                }
+            }
+        }
+        if (!engine.renderPoints(view, points, iter, smooth)) return false;
+        for (size_t n = 0; n < todo.size(); n++)
+            for (int s = 0; s < perPixel; s++) {
+                size_t j = n * perPixel + s;
+                sums[todo[n]].add(sampleColor(iter[j], smooth[j], view.maxIter, options.colorMode));
+            }
+        stats.refined[pass] = todo.size();
+        stats.samples += points.size() / 2;
+        // Дальше — только пиксели, чьи отсчёты всё ещё расходятся
+        todo.erase(std::remove_if(todo.begin(), todo.end(),
+                                  [&](uint32_t i) { return sums[i].spread() <= options.threshold; }),
+                   todo.end());
+        firstStratum = lastStratum;
+    }
+    stats.refineMs = msSince(start);
+
+    rgb.resize(pixels * 3);
+    for (size_t i = 0; i < pixels; i++) {
+        const PixelSum &sum = sums[i];
+        int half = sum.count / 2;
+        rgb[3 * i] = (uint8_t)((sum.r + half) / sum.count);
+        rgb[3 * i + 1] = (uint8_t)((sum.g + half) / sum.count);
+        rgb[3 * i + 2] = (uint8_t)((sum.b + half) / sum.count);
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "engine.h"
+#include "palette.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Адаптивное сглаживание ---
+// Равномерные 16 отсчётов на пиксель стоят в 16 раз дороже везде, хотя
+// большинству пикселей (ровный фон, внутренность) они ничего не дают.
+// Здесь кадр сначала считается обычным render (отсчёт в центре пикселя),
+// затем дополнительные отсчёты получают только пиксели на границах:
+//   проход 1 — пиксели, чей цвет заметно отличается от соседа по стороне
+//              (или ближе пикселя к множеству, если useDistance), получают
+//              4 отсчёта, по одному в каждой четверти;
+//   проход 2 — те из них, у кого отсчёты всё ещё расходятся, получают ещё
+//              12 — вместе 4x4 страты.
+// Отсчёты — со смещением внутри своей страты (хэш от пикселя, так что кадр
+// воспроизводим), считаются Engine::renderPoints. Цвет пикселя — среднее
+// всех его отсчётов.
+struct AntialiasOptions {
+    int maxSamples = 16;          // 1 — без сглаживания, 4 — один проход, 16 — два
+    int threshold = 16;           // разница цвета по каналу (0..255), с которой пиксель уточняется
+    bool useDistance = false;     // уточнять и пиксели ближе пикселя к границе (Engine::setDistance)
+    ColorMode colorMode = COLOR_POLY;
+};
+
+struct AntialiasStats {
+    size_t pixels = 0;
+    size_t refined[2] = {};  // пикселей, уточнённых в каждом проходе
+    size_t samples = 0;      // всего отсчётов, считая основной кадр
+    double baseMs = 0;       // основной кадр
+    double refineMs = 0;     // проходы уточнения
+
+    double samplesPerPixel() const { return pixels ? (double)samples / pixels : 0.0; }
+};
+
+// Сглаженный кадр view: rgb — 3 байта на пиксель, строки снизу вверх, как
+// в IterationBuffer. На основной кадр включает у engine smooth (для
+// COLOR_SMOOTH) и distance (для useDistance), потом возвращает прежние.
+bool renderAntialiased(Engine &engine, const View &view, const AntialiasOptions &options, std::vector<uint8_t> &rgb,
+                       AntialiasStats &stats);
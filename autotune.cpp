@@ -0,0 +1,300 @@
+#include "autotune.h"
+#include "cl_kernel.h"
+#include "kernel_cache.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Эталонные виды для замеров: весь набор и долина морских коньков
+struct TuneView {
+    double centerX, centerY, zoom;
+    int maxIter;
+};
+const TuneView TUNE_VIEWS[] = {
+    {-0.5, 0.0, 2.0, 500},
+    {-0.7436, 0.1318, 0.01, 1000},
+};
+
+// Варианты цикла итераций: {unroll, iterBlock}; одно из двух всегда 1
+const int LOOP_CANDIDATES[][2] = {
+    {1, 1}, {2, 1}, {4, 1}, {8, 1}, {16, 1}, {1, 4}, {1, 8}, {1, 16}, {1, 32},
+};
+// {0, 0} — без явного размера группы, как было до автотюнера
+const size_t LOCAL_CANDIDATES[][2] = {
+    {0, 0},  {8, 8},  {16, 16}, {32, 8},  {8, 32},   {16, 8},   {8, 16},
+    {32, 4}, {16, 4}, {64, 1},  {64, 4},  {128, 1},  {256, 1},  {32, 32},
+};
+// Для persistent: размер группы (1D) и число групп на вычислительный блок
+const size_t PERSIST_LOCAL_CANDIDATES[] = {64, 128, 256};
+const int PERSIST_GROUP_CANDIDATES[] = {2, 4, 8, 16};
+const int RUNS = 3;
+
+std::filesystem::path tuneFile() {
+    const char *xdg = std::getenv("XDG_CACHE_HOME");
+    const char *home = std::getenv("HOME");
+    std::filesystem::path dir = (xdg && *xdg) ? std::filesystem::path(xdg)
+                                : home       ? std::filesystem::path(home) / ".cache"
+                                             : std::filesystem::path(".");
+    return dir / "mandelbrot" / "autotune.txt";
+}
+
+// Ключ: устройство, драйвер, хэш исходника ядра и размер кадра —
+// после обновления драйвера или изменения ядра подбор повторится
+std::string deviceKey(cl_device_id device, int width, int height) {
+    std::ostringstream key;
+    key << deviceString(device, CL_DEVICE_NAME) << '|' << deviceString(device, CL_DRIVER_VERSION) << '|' << std::hex
+        << std::hash<std::string>()(mandelbrotKernel) << std::dec << '|' << width << 'x' << height;
+    return key.str();
+}
+
+// Формат файла: одна строка на устройство,
+// "ключ<TAB>localX localY unroll iterBlock persistent groupsPerUnit
+// standardLocalX standardLocalY" (последних двух нет в старых записях)
+bool loadTune(const std::string &key, TuneConfig &tune) {
+    std::ifstream in(tuneFile());
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos || line.compare(0, tab, key) != 0 || tab != key.size()) continue;
+        std::istringstream values(line.substr(tab + 1));
+        TuneConfig loaded;
+        if (values >> loaded.localX >> loaded.localY >> loaded.unroll >> loaded.iterBlock >> loaded.persistent >>
+            loaded.groupsPerUnit) {
+            if (!(values >> loaded.standardLocalX >> loaded.standardLocalY)) {
+                loaded.standardLocalX = loaded.persistent ? 0 : loaded.localX;
+                loaded.standardLocalY = loaded.persistent ? 0 : loaded.localY;
+            }
+            tune = loaded;
+            return true;
+        }
+    }
+    return false;
+}
+
+void saveTune(const std::string &key, const TuneConfig &tune) {
+    std::filesystem::path path = tuneFile();
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line))
+            if (line.compare(0, key.size() + 1, key + '\t') != 0) lines.push_back(line);
+    }
+    std::ostringstream entry;
+    entry << key << '\t' << tune.localX << ' ' << tune.localY << ' ' << tune.unroll << ' ' << tune.iterBlock << ' '
+          << tune.persistent << ' ' << tune.groupsPerUnit << ' ' << tune.standardLocalX << ' '
+          << tune.standardLocalY;
+    lines.push_back(entry.str());
+
+    // Пишем во временный файл и переименовываем, чтобы не оставить полфайла
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp);
+        for (const std::string &line : lines) out << line << '\n';
+        if (!out) return;
+    }
+    std::filesystem::rename(tmp, path, ec);
+}
+
+// Лучшее из RUNS время (мс) прохода по эталонным видам, -1 если запуск не удался
+double measure(cl_command_queue queue, cl_kernel kernel, cl_device_id device, cl_mem image, cl_mem counter,
+               const TuneConfig &tune, int width, int height) {
+    double best = -1;
+    for (int run = 0; run <= RUNS; run++) {  // нулевой прогон — прогрев
+        auto start = std::chrono::steady_clock::now();
+        for (const TuneView &view : TUNE_VIEWS) {
+            setMandelbrotArgs(kernel, image, width, height, view.centerX, view.centerY, view.zoom, view.maxIter,
+                              COLOR_POLY);
+            if (enqueueFrame(queue, kernel, device, tune, width, height, counter) != CL_SUCCESS) return -1;
+        }
+        if (clFinish(queue) != CL_SUCCESS) return -1;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (run > 0 && (best < 0 || ms < best)) best = ms;
+    }
+    return best;
+}
+
+// Двумерный запуск на прямоугольник кадра через глобальное смещение
+cl_int enqueueRect(cl_command_queue queue, cl_kernel kernel, size_t maxGroup, const TuneConfig &tune, int x, int y,
+                   int width, int height, cl_event *event) {
+    size_t offset[2] = {(size_t)x, (size_t)y};
+    if (tune.localX == 0 || tune.localY == 0 || tune.localX * tune.localY > maxGroup) {
+        size_t global[2] = {(size_t)width, (size_t)height};
+        return clEnqueueNDRangeKernel(queue, kernel, 2, offset, global, nullptr, 0, nullptr, event);
+    }
+    size_t local[2] = {tune.localX, tune.localY};
+    size_t global[2] = {(width + local[0] - 1) / local[0] * local[0], (height + local[1] - 1) / local[1] * local[1]};
+    return clEnqueueNDRangeKernel(queue, kernel, 2, offset, global, local, 0, nullptr, event);
+}
+
+}  // namespace
+
+std::string TuneConfig::buildOptions() const {
+    std::string opts;
+    if (unroll > 1) opts += " -D SPEC_UNROLL=" + std::to_string(unroll);
+    if (iterBlock > 1) opts += " -D SPEC_ITER_BLOCK=" + std::to_string(iterBlock);
+    return opts;
+}
+
+const char *TuneConfig::kernelName() const {
+    return persistent ? "mandelbrot_persistent" : "mandelbrot";
+}
+
+cl_int enqueueFrame(cl_command_queue queue, cl_kernel kernel, cl_device_id device, const TuneConfig &tune,
+                    int width, int height, cl_mem counter, cl_event *event, cl_mem stats) {
+    if (stats) {
+        cl_uint zero = 0;
+        clEnqueueFillBuffer(queue, stats, &zero, sizeof(zero), 0, sizeof(cl_uint) * KERNEL_STATS_WORDS, 0, nullptr,
+                            nullptr);
+        cl_uint index = tune.persistent ? 9 : 8;
+        clSetKernelArg(kernel, index, sizeof(cl_mem), &stats);
+    }
+    size_t maxGroup = 0;
+    clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup, nullptr);
+    if (tune.persistent) {
+        cl_uint units = 1;
+        clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, nullptr);
+        size_t local = tune.localX * tune.localY;
+        if (local == 0 || local > maxGroup) local = std::min<size_t>(64, maxGroup);
+        size_t global = local * units * tune.groupsPerUnit;
+        cl_int zero = 0;
+        clEnqueueFillBuffer(queue, counter, &zero, sizeof(zero), 0, sizeof(zero), 0, nullptr, nullptr);
+        clSetKernelArg(kernel, 8, sizeof(cl_mem), &counter);
+        return clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &global, &local, 0, nullptr, event);
+    }
+    return enqueueRect(queue, kernel, maxGroup, tune, 0, 0, width, height, event);
+}
+
+TuneConfig standardTune(const TuneConfig &tune, int tile) {
+    TuneConfig result = tune;
+    if (result.persistent) {
+        result.persistent = false;
+        result.localX = result.standardLocalX;
+        result.localY = result.standardLocalY;
+    }
+    bool fits = result.localX > 0 && result.localY > 0 && tile % result.localX == 0 && tile % result.localY == 0;
+    if (tile > 0 && !fits) result.localX = result.localY = 0;
+    return result;
+}
+
+cl_int enqueueTile(cl_command_queue queue, cl_kernel kernel, cl_device_id device, const TuneConfig &tune, int x,
+                   int y, int width, int height, cl_event *event, cl_mem stats) {
+    if (stats) {
+        cl_uint zero = 0;
+        clEnqueueFillBuffer(queue, stats, &zero, sizeof(zero), 0, sizeof(cl_uint) * KERNEL_STATS_WORDS, 0, nullptr,
+                            nullptr);
+        clSetKernelArg(kernel, 8, sizeof(cl_mem), &stats);
+    }
+    size_t maxGroup = 0;
+    clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup, nullptr);
+    return enqueueRect(queue, kernel, maxGroup, tune, x, y, width, height, event);
+}
+
+TuneConfig autotune(cl_context context, cl_device_id device, cl_command_queue queue, int width, int height,
+                    bool retune) {
+    std::string key = deviceKey(device, width, height);
+    TuneConfig best;
+    if (!retune && loadTune(key, best)) return best;
+
+    TRACE_SPAN("autotune");
+    std::cerr << "autotune: " << deviceString(device, CL_DEVICE_NAME) << ", first run, measuring..." << std::endl;
+    size_t deviceMaxGroup = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(deviceMaxGroup), &deviceMaxGroup, nullptr);
+
+    cl_int err;
+    cl_mem image = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_uchar4) * width * height, nullptr, &err);
+    if (err != CL_SUCCESS) return best;
+    cl_mem counter = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int), nullptr, &err);
+
+    double bestMs = -1;
+    for (const auto &loop : LOOP_CANDIDATES) {
+        TuneConfig tune;
+        tune.unroll = loop[0];
+        tune.iterBlock = loop[1];
+        cl_program program;
+        cl_kernel kernel = buildMandelbrot(context, device, tune.buildOptions(), "mandelbrot", program);
+        if (!kernel) continue;
+        size_t kernelMaxGroup = 0;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMaxGroup), &kernelMaxGroup,
+                                 nullptr);
+
+        for (const auto &local : LOCAL_CANDIDATES) {
+            size_t groupSize = local[0] * local[1];
+            if (groupSize > std::min(deviceMaxGroup, kernelMaxGroup)) continue;
+            tune.localX = tune.standardLocalX = local[0];
+            tune.localY = tune.standardLocalY = local[1];
+            double ms = measure(queue, kernel, device, image, counter, tune, width, height);
+            if (ms < 0) continue;
+            std::cerr << "autotune: unroll " << tune.unroll << ", block " << tune.iterBlock << ", local " << local[0]
+                      << "x" << local[1] << ": " << ms << " ms" << std::endl;
+            if (bestMs < 0 || ms < bestMs) {
+                bestMs = ms;
+                best = tune;
+            }
+        }
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+
+    // Постоянные потоки — сравниваем с лучшим вариантом обычного ядра
+    double bestStandardMs = bestMs;
+    cl_program program;
+    cl_kernel kernel = buildMandelbrot(context, device, "", "mandelbrot_persistent", program);
+    if (kernel) {
+        // Как у обычного ядра: больше группы, чем позволяет ядро, enqueueFrame
+        // не запустит, и замерена была бы другая конфигурация
+        size_t kernelMaxGroup = 0;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMaxGroup), &kernelMaxGroup,
+                                 nullptr);
+        TuneConfig tune;
+        tune.persistent = true;
+        tune.standardLocalX = best.standardLocalX;
+        tune.standardLocalY = best.standardLocalY;
+        double bestPersistentMs = -1;
+        for (size_t local : PERSIST_LOCAL_CANDIDATES) {
+            if (local > std::min(deviceMaxGroup, kernelMaxGroup)) continue;
+            for (int groups : PERSIST_GROUP_CANDIDATES) {
+                tune.localX = local;
+                tune.localY = 1;
+                tune.groupsPerUnit = groups;
+                double ms = measure(queue, kernel, device, image, counter, tune, width, height);
+                if (ms < 0) continue;
+                std::cerr << "autotune: persistent, local " << local << ", " << groups << " groups/unit: " << ms
+                          << " ms" << std::endl;
+                if (bestPersistentMs < 0 || ms < bestPersistentMs) bestPersistentMs = ms;
+                if (bestMs < 0 || ms < bestMs) {
+                    bestMs = ms;
+                    best = tune;
+                }
+            }
+        }
+        if (bestPersistentMs >= 0)
+            std::cerr << "autotune: mandelbrot_persistent " << bestPersistentMs << " ms vs mandelbrot "
+                      << bestStandardMs << " ms" << std::endl;
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+    clReleaseMemObject(counter);
+    clReleaseMemObject(image);
+
+    if (bestMs >= 0) {
+        std::cerr << "autotune: best " << best.kernelName() << ", unroll " << best.unroll << ", block "
+                  << best.iterBlock << ", local " << best.localX << "x" << best.localY << " (" << bestMs << " ms)"
+                  << std::endl;
+        saveTune(key, best);
+    }
+    return best;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "cl_utils.h"
+#include <string>
+
+// --- Настройки запуска ядра, подобранные автотюнером ---
+struct TuneConfig {
+    size_t localX = 0;  // 0 — размер рабочей группы выбирает драйвер
+    size_t localY = 0;
+    int unroll = 1;     // развёртка цикла итераций (SPEC_UNROLL)
+    int iterBlock = 1;  // итераций между проверками выхода (SPEC_ITER_BLOCK)
+    bool persistent = false;  // ядро mandelbrot_persistent вместо mandelbrot
+    int groupsPerUnit = 4;    // рабочих групп на вычислительный блок в persistent
+    // Лучший размер группы обычного ядра, даже если выиграл persistent: им
+    // запускаются плитки и ядра mandelbrot_iter (standardTune)
+    size_t standardLocalX = 0;
+    size_t standardLocalY = 0;
+
+    // -D опции, которые добавляются ко всем вариантам ядра
+    std::string buildOptions() const;
+    const char *kernelName() const;
+};
+
+// --- Запуск ядра на кадр width x height ---
+// Глобальный размер округляется вверх до кратного размеру группы; если ядро
+// не допускает группу такого размера, размер выбирает драйвер. Для
+// persistent ядра counter — буфер из одного int, он обнуляется перед запуском.
+// stats — буфер статистики для ядра, собранного с SPEC_STATS (последний
+// аргумент ядра), тоже обнуляется; nullptr — ядро без статистики.
+cl_int enqueueFrame(cl_command_queue queue, cl_kernel kernel, cl_device_id device, const TuneConfig &tune,
+                    int width, int height, cl_mem counter, cl_event *event = nullptr, cl_mem stats = nullptr);
+
+// --- Запуск обычного (не persistent) ядра на прямоугольник кадра ---
+// Рабочие элементы получают глобальные координаты пикселей кадра. Размер
+// округляется вверх до группы; то, что выходит за кадр, отсекает ядро.
+// Заход в соседнюю плитку ядро не отсекает — он пересчитал бы её пиксели
+// и посчитал их в статистике дважды, поэтому плитки запускаются с
+// настройками standardTune(tune, сторона плитки).
+cl_int enqueueTile(cl_command_queue queue, cl_kernel kernel, cl_device_id device, const TuneConfig &tune, int x,
+                   int y, int width, int height, cl_event *event = nullptr, cl_mem stats = nullptr);
+
+// --- Настройки обычного ядра ---
+// persistent ядро плитки и отдельные кадры не считает: вместо него обычное
+// с лучшим для обычного ядра размером группы. tile > 0 — для плиток с такой
+// стороной: размер группы, на который tile не делится, тоже отдаётся
+// драйверу — глобальный размер тогда не округляется, и запуск не заходит в
+// соседние плитки.
+TuneConfig standardTune(const TuneConfig &tune, int tile = 0);
+
+// --- Автотюнер ---
+// При первом запуске на устройстве перебирает размеры и формы рабочей группы
+// вместе с развёрткой цикла или блоками итераций без проверки выхода,
+// а также ядро с постоянными потоками, замеряя время кадра width x height
+// на эталонных видах.
+// Лучшая конфигурация сохраняется в ~/.cache/mandelbrot/autotune.txt под
+// ключом "устройство + драйвер + версия ядра" и при следующих запусках
+// просто читается оттуда. retune == true заставляет перебрать заново.
+TuneConfig autotune(cl_context context, cl_device_id device, cl_command_queue queue, int width, int height,
+                    bool retune = false);
@@ -0,0 +1,461 @@
+// --- Бенчмарк: эталонные виды на всех вычислителях, отчёт в JSON ---
+// Использование: bench [--runs N] [--size WxH] [--engine подстрока]
+//                      [--view подстрока] [--out файл.json] [--cache-mb N]
+//                      [--tile-store каталог] [--png-level 0..9]
+//                      [--png-threads N] [--equalize] [--distance]
+//                      [--aa 4|16] [--interior] [--formula формула]
+// --cache-mb: считать через кэш плиток (CachedEngine) с таким бюджетом;
+// прогрев заполняет кэш, замеры показывают стоимость сборки вида из плиток.
+// --tile-store: кэш плиток дополнительно сохраняется на диск (TileStore),
+// повторный запуск берёт плитки оттуда.
+// --png-level: после замеров раскрасить последний кадр и сжать в PNG (в
+// память) — видно, сколько стоит кодирование рядом с расчётом;
+// --png-threads: потоков сжатия (0 — по числу ядер).
+// --equalize: после замеров раскрасить последний кадр выравниванием
+// гистограммы тем же вычислителем (Engine::equalize), время по проходам.
+// --distance: повторить замеры с оценкой расстояния (Engine::setDistance) —
+// во сколько обходится производная dz/dc по сравнению с обычным расчётом.
+// --aa: кадр с адаптивным сглаживанием (antialias.h) до 4 или 16 отсчётов
+// на пиксель; для сравнения тот же кадр считается равномерно 4x4 отсчёта
+// на пиксель, и качество обоих вариантов (и 1 отсчёта) — PSNR против него.
+// --interior: повторить замеры с проверкой производной внутри множества
+// (Engine::setInteriorCheck) — сколько пикселей она ловит, ускорение и
+// сколько пикселей разошлось с обычным расчётом.
+// --formula: считать те же виды другой формулой (formula.h, Engine::setFormula):
+// julia:X,Y, multibrot:N или burning-ship; без --distance и --interior.
+#include "antialias.h"
+#include "cached_engine.h"
+#include "engine.h"
+#include "palette.h"
+#include "png_writer.h"
+#include "tile_store.h"
+#include "views.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int runs = 5;
+    int width = 800;
+    int height = 600;
+    std::string engineFilter;
+    std::string viewFilter;
+    std::string out;
+    size_t cacheMb = 0;  // 0 — без кэша плиток
+    std::string tileStore;
+    int pngLevel = -1;  // -1 — не кодировать
+    int pngThreads = 0;
+    bool equalize = false;
+    bool distance = false;
+    int aaSamples = 0;  // 0 — без сглаживания
+    bool interior = false;
+    Formula formula;
+};
+
+struct Result {
+    std::string engine;
+    std::string view;
+    View params;
+    std::vector<double> wallMs;
+    WorkStats stats;  // последнего прогона
+    std::vector<double> encodeMs;
+    size_t pngBytes = 0;
+    std::vector<double> equalizeMs;
+    EqualizeStats equalizeStats;  // последнего прогона
+    std::vector<double> distanceMs;
+    std::vector<double> aaMs;
+    AntialiasStats aaStats;  // последнего прогона
+    double uniformMs = 0;    // 16 отсчётов на пиксель
+    double aaPsnr = 0, basePsnr = 0;
+    std::vector<double> interiorMs;
+    WorkStats interiorStats;   // последнего прогона
+    uint64_t interiorDiff = 0;  // пикселей с другим числом итераций
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(arg, "--runs") == 0 && value) {
+            options.runs = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--size") == 0 && value) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2) return false;
+        } else if (std::strcmp(arg, "--engine") == 0 && value) {
+            options.engineFilter = value;
+        } else if (std::strcmp(arg, "--view") == 0 && value) {
+            options.viewFilter = value;
+        } else if (std::strcmp(arg, "--out") == 0 && value) {
+            options.out = value;
+        } else if (std::strcmp(arg, "--cache-mb") == 0 && value) {
+            options.cacheMb = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--tile-store") == 0 && value) {
+            options.tileStore = value;
+        } else if (std::strcmp(arg, "--png-level") == 0 && value) {
+            options.pngLevel = std::atoi(value);
+            if (options.pngLevel < 0 || options.pngLevel > 9) return false;
+        } else if (std::strcmp(arg, "--png-threads") == 0 && value) {
+            options.pngThreads = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--equalize") == 0) {
+            options.equalize = true;
+            continue;
+        } else if (std::strcmp(arg, "--distance") == 0) {
+            options.distance = true;
+            continue;
+        } else if (std::strcmp(arg, "--interior") == 0) {
+            options.interior = true;
+            continue;
+        } else if (std::strcmp(arg, "--aa") == 0 && value) {
+            options.aaSamples = std::atoi(value);
+            if (options.aaSamples != 4 && options.aaSamples != 16) return false;
+        } else if (std::strcmp(arg, "--formula") == 0 && value) {
+            if (!parseFormula(value, options.formula)) return false;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    // Хранилище работает только через кэш в памяти; кэш плиток хранит
+    // только итерации
+    if (!options.tileStore.empty() && options.cacheMb == 0) return false;
+    if ((options.distance || options.aaSamples || options.interior) && options.cacheMb > 0) return false;
+    // Производную считает только Mandelbrot
+    if ((options.distance || options.interior) && options.formula.kind != FORMULA_MANDELBROT) return false;
+    return options.width > 0 && options.height > 0;
+}
+
+std::string jsonString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if ((unsigned char)c >= 0x20) quoted += c;
+    }
+    return quoted + "\"";
+}
+
+double mean(const std::vector<double> &values) {
+    double sum = 0;
+    for (double v : values) sum += v;
+    return sum / values.size();
+}
+
+double stddev(const std::vector<double> &values) {
+    if (values.size() < 2) return 0.0;
+    double m = mean(values), sum = 0;
+    for (double v : values) sum += (v - m) * (v - m);
+    return std::sqrt(sum / (values.size() - 1));
+}
+
+// --- Эталон сглаживания: 4x4 отсчёта на пиксель равномерно ---
+// Вид в 4 раза подробнее по каждой оси, сдвинутый так, что отсчёты пикселя
+// x лежат в x - 0.375 ... x + 0.375 (как страты antialias.cpp); rgb —
+// среднее блоков 4x4, строки снизу вверх. false, если расчёт не удался.
+bool renderUniform16(Engine &engine, const View &view, std::vector<uint8_t> &rgb) {
+    View fine = view;
+    fine.width = view.width * 4;
+    fine.height = view.height * 4;
+    double scale = view.zoom / view.height;
+    fine.centerX -= 0.375 * scale;
+    fine.centerY -= 0.375 * scale;
+    // Эталону нужны только итерации: smooth выключен на этот кадр
+    bool wasSmooth = engine.smooth();
+    engine.setSmooth(false);
+    IterationBuffer buffer;
+    bool rendered = engine.render(fine, buffer);
+    engine.setSmooth(wasSmooth);
+    if (!rendered) return false;
+    rgb.assign((size_t)view.width * view.height * 3, 0);
+    for (int y = 0; y < view.height; y++) {
+        for (int x = 0; x < view.width; x++) {
+            int sum[3] = {};
+            for (int j = 0; j < 16; j++) {
+                Rgb c = colorize(buffer.iter[(size_t)(4 * y + j / 4) * fine.width + 4 * x + j % 4], view.maxIter,
+                                 COLOR_POLY);
+                sum[0] += c.r;
+                sum[1] += c.g;
+                sum[2] += c.b;
+            }
+            uint8_t *dst = &rgb[((size_t)y * view.width + x) * 3];
+            for (int c = 0; c < 3; c++) dst[c] = (uint8_t)((sum[c] + 8) / 16);
+        }
+    }
+    return true;
+}
+
+double psnr(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+    double sum = 0;
+    for (size_t i = 0; i < a.size(); i++) sum += (a[i] - b[i]) * (a[i] - b[i]);
+    if (sum == 0) return 99.0;
+    return 10 * std::log10(255.0 * 255.0 * a.size() / sum);
+}
+
+// Раскрасить кадр и сжать в PNG в памяти; размер PNG или 0 при ошибке
+size_t encodePng(const IterationBuffer &buffer, int maxIter, int level, int threads) {
+    std::ostringstream out;
+    PngWriter png;
+    if (!png.open(out, buffer.width, buffer.height, level, threads)) return 0;
+    std::vector<uint8_t> rgb((size_t)buffer.width * 3);
+    // Строки буфера идут снизу вверх, PNG — сверху вниз
+    for (int y = buffer.height - 1; y >= 0; y--) {
+        colorizeRow(&buffer.iter[(size_t)y * buffer.width], buffer.width, maxIter, COLOR_POLY, rgb.data());
+        png.writeRows(rgb.data(), 1);
+    }
+    return png.close() ? (size_t)out.tellp() : 0;
+}
+
+void writeJson(std::ostream &out, const Options &options, const std::vector<Result> &results) {
+    out << "{\n  \"timestamp\": " << std::time(nullptr) << ",\n  \"compiler\": " << jsonString(__VERSION__)
+        << ",\n  \"runs\": " << options.runs << ",\n  \"formula\": " << jsonString(formulaName(options.formula))
+        << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        double meanMs = mean(r.wallMs);
+        double minMs = r.wallMs[0], maxMs = r.wallMs[0];
+        for (double ms : r.wallMs) {
+            minMs = std::min(minMs, ms);
+            maxMs = std::max(maxMs, ms);
+        }
+        double pixels = (double)r.params.width * r.params.height;
+        out << (i ? ",\n" : "\n") << "    {\"engine\": " << jsonString(r.engine) << ", \"view\": " << jsonString(r.view)
+            << ", \"width\": " << r.params.width << ", \"height\": " << r.params.height
+            << ", \"max_iter\": " << r.params.maxIter << ",\n     \"wall_ms\": {\"mean\": " << meanMs
+            << ", \"stddev\": " << stddev(r.wallMs) << ", \"min\": " << minMs << ", \"max\": " << maxMs
+            << "},\n     \"mpixels_per_s\": " << pixels / (meanMs * 1e3)
+            << ", \"iterations\": " << r.stats.iterations
+            << ", \"iterations_per_s\": " << r.stats.iterations / (meanMs * 1e-3)
+            << ",\n     \"pixels\": {\"escaped\": " << r.stats.escaped << ", \"max_iter\": " << r.stats.maxed
+            << ", \"skipped\": " << r.stats.skipped << ", \"interior\": " << r.stats.interior
+            << "},\n     \"histogram\": [";
+        for (int bin = 0; bin < WorkStats::HISTOGRAM_BINS; bin++) out << (bin ? ", " : "") << r.stats.histogram[bin];
+        out << "]";
+        if (!r.encodeMs.empty())
+            out << ",\n     \"png\": {\"level\": " << options.pngLevel << ", \"threads\": " << options.pngThreads
+                << ", \"encode_ms\": {\"mean\": " << mean(r.encodeMs) << ", \"stddev\": " << stddev(r.encodeMs)
+                << "}, \"bytes\": " << r.pngBytes << "}";
+        if (!r.distanceMs.empty())
+            out << ",\n     \"distance\": {\"wall_ms\": {\"mean\": " << mean(r.distanceMs)
+                << ", \"stddev\": " << stddev(r.distanceMs) << "}, \"overhead\": " << mean(r.distanceMs) / meanMs
+                << "}";
+        if (!r.interiorMs.empty())
+            out << ",\n     \"interior\": {\"wall_ms\": {\"mean\": " << mean(r.interiorMs)
+                << ", \"stddev\": " << stddev(r.interiorMs) << "}, \"speedup\": " << meanMs / mean(r.interiorMs)
+                << ", \"caught\": " << r.interiorStats.interior << ", \"iterations\": " << r.interiorStats.iterations
+                << ", \"differing_pixels\": " << r.interiorDiff << "}";
+        if (!r.aaMs.empty()) {
+            const AntialiasStats &a = r.aaStats;
+            out << ",\n     \"aa\": {\"max_samples\": " << options.aaSamples << ", \"wall_ms\": {\"mean\": "
+                << mean(r.aaMs) << ", \"stddev\": " << stddev(r.aaMs) << "}, \"samples_per_pixel\": "
+                << a.samplesPerPixel() << ", \"refined\": [" << a.refined[0] << ", " << a.refined[1]
+                << "], \"uniform16_ms\": " << r.uniformMs << ", \"psnr_db\": " << r.aaPsnr
+                << ", \"psnr_1spp_db\": " << r.basePsnr << "}";
+        }
+        if (!r.equalizeMs.empty()) {
+            const EqualizeStats &e = r.equalizeStats;
+            out << ",\n     \"equalize\": {\"wall_ms\": {\"mean\": " << mean(r.equalizeMs)
+                << ", \"stddev\": " << stddev(r.equalizeMs) << "}, \"histogram_ms\": " << e.histogramMs
+                << ", \"cdf_ms\": " << e.cdfMs << ", \"map_ms\": " << e.mapMs << ", \"upload_ms\": " << e.uploadMs
+                << ", \"readback_ms\": " << e.readbackMs << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: bench [--runs N] [--size WxH] [--engine substr] [--view substr] [--out file.json]"
+                     " [--cache-mb N] [--tile-store dir] [--png-level 0..9] [--png-threads N] [--equalize]"
+                     " [--distance] [--aa 4|16] [--interior] [--formula mandelbrot|julia:X,Y|multibrot:N|burning-ship]"
+                  << std::endl;
+        return 2;
+    }
+
+    std::vector<Result> results;
+    IterationBuffer buffer;
+    std::vector<std::unique_ptr<Engine>> engines = createEngines();
+    std::shared_ptr<TileStore> store;
+    if (!options.tileStore.empty()) store = std::make_shared<TileStore>(options.tileStore);
+    if (options.cacheMb > 0) {
+        for (auto &engine : engines) {
+            auto cache = std::make_shared<TileCache>(options.cacheMb << 20);
+            cache->setStore(store);
+            engine = std::make_unique<CachedEngine>(std::move(engine), cache);
+        }
+    }
+    for (auto &engine : engines) {
+        std::string engineName = engine->name();
+        if (engineName.find(options.engineFilter) == std::string::npos) continue;
+        engine->setFormula(options.formula);
+
+        for (const NamedView &named : canonicalViews()) {
+            if (std::string(named.name).find(options.viewFilter) == std::string::npos) continue;
+            Result result;
+            result.engine = engineName;
+            result.view = named.name;
+            result.params = named.view;
+            result.params.width = options.width;
+            result.params.height = options.height;
+
+            // Прогрев: сборка ядра, автотюнер, выделение буферов
+            if (!engine->render(result.params, buffer)) {
+                std::cerr << engineName << ": render failed on " << named.name << std::endl;
+                break;
+            }
+
+            // Сбой после прогрева — не быстрый замер, а конец этого вычислителя
+            bool failed = false;
+            for (int run = 0; run < options.runs && !failed; run++) {
+                auto start = std::chrono::steady_clock::now();
+                failed = !engine->render(result.params, buffer);
+                result.wallMs.push_back(
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+            if (failed) {
+                std::cerr << engineName << ": render failed on " << named.name << std::endl;
+                break;
+            }
+            result.stats = engine->stats();
+            double meanMs = mean(result.wallMs);
+            double pixels = (double)options.width * options.height;
+            std::fprintf(stderr, "%-40s %-14s %9.2f ms +- %6.2f  %8.1f Mpix/s  %8.3f Giter/s  %5.1f%% skipped\n",
+                         engineName.c_str(), named.name, meanMs, stddev(result.wallMs), pixels / (meanMs * 1e3),
+                         result.stats.iterations / (meanMs * 1e6), 100.0 * result.stats.skipped / pixels);
+
+            if (options.pngLevel >= 0) {
+                for (int run = 0; run < options.runs; run++) {
+                    auto start = std::chrono::steady_clock::now();
+                    result.pngBytes = encodePng(buffer, result.params.maxIter, options.pngLevel, options.pngThreads);
+                    result.encodeMs.push_back(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                std::fprintf(stderr, "%-40s %-14s %9.2f ms +- %6.2f  png level %d, %zu bytes\n", "", "",
+                             mean(result.encodeMs), stddev(result.encodeMs), options.pngLevel, result.pngBytes);
+            }
+            if (options.distance) {
+                // Прогрев заново: у OpenCL это другой вариант ядра
+                engine->setDistance(true);
+                bool ok = engine->render(result.params, buffer);
+                for (int run = 0; ok && run < options.runs; run++) {
+                    auto start = std::chrono::steady_clock::now();
+                    ok = engine->render(result.params, buffer);
+                    result.distanceMs.push_back(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                engine->setDistance(false);
+                if (!ok) {
+                    // В отчёт не попадают замеры оборванной серии
+                    result.distanceMs.clear();
+                    std::cerr << engineName << ": distance render failed on " << named.name << std::endl;
+                } else {
+                    std::fprintf(stderr, "%-40s %-14s %9.2f ms +- %6.2f  distance estimate, x%.2f\n", "", "",
+                                 mean(result.distanceMs), stddev(result.distanceMs), mean(result.distanceMs) / meanMs);
+                }
+            }
+            if (options.interior) {
+                // Прогрев заново: у OpenCL это другой вариант ядра
+                std::vector<uint32_t> plain = buffer.iter;
+                engine->setInteriorCheck(true);
+                bool ok = engine->render(result.params, buffer);
+                for (int run = 0; ok && run < options.runs; run++) {
+                    auto start = std::chrono::steady_clock::now();
+                    ok = engine->render(result.params, buffer);
+                    result.interiorMs.push_back(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                engine->setInteriorCheck(false);
+                if (ok) {
+                    result.interiorStats = engine->stats();
+                    for (size_t i = 0; i < plain.size(); i++) result.interiorDiff += plain[i] != buffer.iter[i];
+                }
+                // Сглаживание и раскраска ниже — по обычному кадру
+                buffer.iter = std::move(plain);
+                if (!ok) {
+                    result.interiorMs.clear();
+                    std::cerr << engineName << ": interior render failed on " << named.name << std::endl;
+                } else {
+                    std::fprintf(stderr,
+                                 "%-40s %-14s %9.2f ms +- %6.2f  interior check, x%.2f, %.1f%% caught, %llu differ\n",
+                                 "", "", mean(result.interiorMs), stddev(result.interiorMs),
+                                 meanMs / mean(result.interiorMs), 100.0 * result.interiorStats.interior / pixels,
+                                 (unsigned long long)result.interiorDiff);
+                }
+            }
+            if (options.aaSamples) {
+                AntialiasOptions aa;
+                aa.maxSamples = options.aaSamples;
+                std::vector<uint8_t> rgb, reference;
+                for (int run = 0; run < options.runs; run++) {
+                    auto start = std::chrono::steady_clock::now();
+                    if (!renderAntialiased(*engine, result.params, aa, rgb, result.aaStats)) break;
+                    result.aaMs.push_back(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                auto start = std::chrono::steady_clock::now();
+                if (!result.aaMs.empty() && renderUniform16(*engine, result.params, reference)) {
+                    result.uniformMs =
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    // 1 отсчёт на пиксель — кадр из замеров выше
+                    std::vector<uint8_t> base(rgb.size());
+                    for (size_t i = 0; i < buffer.iter.size(); i++) {
+                        Rgb c = colorize(buffer.iter[i], result.params.maxIter, COLOR_POLY);
+                        base[3 * i] = c.r;
+                        base[3 * i + 1] = c.g;
+                        base[3 * i + 2] = c.b;
+                    }
+                    result.aaPsnr = psnr(rgb, reference);
+                    result.basePsnr = psnr(base, reference);
+                    std::fprintf(stderr,
+                                 "%-40s %-14s %9.2f ms +- %6.2f  aa %.2f samples/pixel, PSNR %.1f dB (1 spp %.1f dB),"
+                                 " uniform 16x %.2f ms\n",
+                                 "", "", mean(result.aaMs), stddev(result.aaMs), result.aaStats.samplesPerPixel(),
+                                 result.aaPsnr, result.basePsnr, result.uniformMs);
+                }
+            }
+            if (options.equalize) {
+                std::vector<uint8_t> rgb;
+                for (int run = 0; run < options.runs; run++) {
+                    auto start = std::chrono::steady_clock::now();
+                    if (!engine->equalize(buffer, result.params.maxIter, rgb)) break;
+                    result.equalizeMs.push_back(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                result.equalizeStats = engine->equalizeStats();
+                const EqualizeStats &e = result.equalizeStats;
+                if (!result.equalizeMs.empty())
+                    std::fprintf(stderr,
+                                 "%-40s %-14s %9.2f ms +- %6.2f  equalize: histogram %.2f, cdf %.2f, map %.2f,"
+                                 " transfer %.2f ms\n",
+                                 "", "", mean(result.equalizeMs), stddev(result.equalizeMs), e.histogramMs, e.cdfMs,
+                                 e.mapMs, e.uploadMs + e.readbackMs);
+            }
+            results.push_back(std::move(result));
+        }
+    }
+
+    if (store) printTileStoreStats(*store);
+
+    if (options.out.empty()) {
+        writeJson(std::cout, options, results);
+    } else {
+        std::ofstream out(options.out);
+        writeJson(out, options, results);
+        if (!out) {
+            std::cerr << "cannot write " << options.out << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "cached_engine.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Самый глубокий уровень: индексы отсчётов должны помещаться в int64
+const int MAX_LEVEL = 56;
+
+int64_t floorDiv(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Индексы ближайших отсчётов сетки с шагом step для пикселей одной оси
+std::vector<int64_t> sampleIndices(double center, int size, double scale, double step) {
+    std::vector<int64_t> indices(size);
+    for (int i = 0; i < size; i++) indices[i] = (int64_t)std::floor((center + (i - size / 2.0) * scale) / step + 0.5);
+    return indices;
+}
+
+// Плитка из четырёх дочерних уровнем глубже: её отсчёт i совпадает с
+// отсчётом 2i дочерней сетки. Так отдаление обходится без расчёта.
+TileCache::Tile fromChildren(TileCache &cache, const TileKey &key) {
+    const int tile = TileCache::TILE, half = tile / 2;
+    if (key.level >= MAX_LEVEL) return nullptr;
+    TileCache::Tile children[4];
+    TileKey child = key;
+    child.level = key.level + 1;
+    for (int k = 0; k < 4; k++) {
+        child.tx = 2 * key.tx + (k & 1);
+        child.ty = 2 * key.ty + (k >> 1);
+        children[k] = cache.find(child);
+        if (!children[k]) return nullptr;
+    }
+    auto samples = std::make_shared<std::vector<uint32_t>>((size_t)tile * tile);
+    for (int j = 0; j < tile; j++)
+        for (int i = 0; i < tile; i++) {
+            const std::vector<uint32_t> &source = *children[(j >= half) * 2 + (i >= half)];
+            (*samples)[(size_t)j * tile + i] = source[(size_t)(2 * j % tile) * tile + 2 * i % tile];
+        }
+    cache.insert(key, samples);
+    return samples;
+}
+
+}  // namespace
+
+CachedEngine::CachedEngine(std::unique_ptr<Engine> inner, std::shared_ptr<TileCache> cache)
+    : inner_(std::move(inner)), cache_(std::move(cache)) {}
+
+std::string CachedEngine::name() const {
+    return "cached " + inner_->name();
+}
+
+bool CachedEngine::render(const View &view, IterationBuffer &out) {
+    TRACE_SPAN("cached render");
+    const int tile = TileCache::TILE;
+    double scale = view.zoom / view.height;
+    int level = (int)std::ceil(std::log2(TILE_BASE / (tile * scale)));
+    level = std::min(std::max(level, 0), MAX_LEVEL);
+    double step = TILE_BASE / std::ldexp(1.0, level) / tile;
+
+    // Сетка разделима: отсчёт пикселя (x, y) — (columns[x], rows[y])
+    std::vector<int64_t> columns = sampleIndices(view.centerX, view.width, scale, step);
+    std::vector<int64_t> rows = sampleIndices(view.centerY, view.height, scale, step);
+    int64_t tx0 = floorDiv(columns.front(), tile), ty0 = floorDiv(rows.front(), tile);
+    int nx = (int)(floorDiv(columns.back(), tile) - tx0 + 1);
+    int ny = (int)(floorDiv(rows.back(), tile) - ty0 + 1);
+
+    // Плитки из кэша и прямоугольник недостающих (в номерах плиток от tx0, ty0)
+    std::vector<TileCache::Tile> tiles((size_t)nx * ny);
+    std::vector<char> cached(tiles.size());
+    int mx0 = nx, my0 = ny, mx1 = -1, my1 = -1;
+    TileKey key;
+    key.level = level;
+    key.maxIter = view.maxIter;
+    key.precision = precision();
+    key.formula = formulaKey(formula_);
+    for (int j = 0; j < ny; j++)
+        for (int i = 0; i < nx; i++) {
+            key.tx = tx0 + i;
+            key.ty = ty0 + j;
+            TileCache::Tile &found = tiles[(size_t)j * nx + i];
+            found = cache_->find(key);
+            if (!found) found = fromChildren(*cache_, key);
+            cached[(size_t)j * nx + i] = found != nullptr;
+            if (found) continue;
+            mx0 = std::min(mx0, i);
+            my0 = std::min(my0, j);
+            mx1 = std::max(mx1, i);
+            my1 = std::max(my1, j);
+        }
+
+    // Недостающие плитки — одним видом на весь прямоугольник: вычислитель
+    // распараллеливает его сам, отсчёты совпадают с сеткой плиток
+    uint64_t iterations = 0;
+    if (mx1 >= 0) {
+        View missingView;
+        missingView.width = (mx1 - mx0 + 1) * tile;
+        missingView.height = (my1 - my0 + 1) * tile;
+        missingView.zoom = missingView.height * step;
+        missingView.centerX = ((tx0 + mx0) * tile + missingView.width / 2.0) * step;
+        missingView.centerY = ((ty0 + my0) * tile + missingView.height / 2.0) * step;
+        missingView.maxIter = view.maxIter;
+        inner_->setFormula(formula_);
+        if (!inner_->render(missingView, missing_)) return false;
+        iterations = inner_->stats().iterations;
+
+        std::vector<std::pair<TileKey, TileCache::Tile>> fresh;
+        for (int j = my0; j <= my1; j++)
+            for (int i = mx0; i <= mx1; i++) {
+                size_t index = (size_t)j * nx + i;
+                if (cached[index]) continue;
+                auto samples = std::make_shared<std::vector<uint32_t>>((size_t)tile * tile);
+                for (int row = 0; row < tile; row++) {
+                    const uint32_t *src =
+                        &missing_.iter[(size_t)((j - my0) * tile + row) * missing_.width + (i - mx0) * tile];
+                    std::copy(src, src + tile, samples->begin() + (size_t)row * tile);
+                }
+                key.tx = tx0 + i;
+                key.ty = ty0 + j;
+                tiles[index] = samples;
+                fresh.emplace_back(key, samples);
+            }
+        cache_->insert(fresh);
+    }
+
+    // --- Сборка вида из плиток ---
+    out.resize(view.width, view.height);
+    stats_.reset(view.maxIter);
+    std::vector<int> tileColumn(view.width), sampleColumn(view.width);
+    for (int x = 0; x < view.width; x++) {
+        tileColumn[x] = (int)(floorDiv(columns[x], tile) - tx0);
+        sampleColumn[x] = (int)(columns[x] - (tx0 + tileColumn[x]) * tile);
+    }
+    for (int y = 0; y < view.height; y++) {
+        int tileRow = (int)(floorDiv(rows[y], tile) - ty0);
+        int sampleRow = (int)(rows[y] - (ty0 + tileRow) * tile);
+        uint32_t *dst = &out.iter[(size_t)y * view.width];
+        for (int x = 0; x < view.width; x++) {
+            size_t index = (size_t)tileRow * nx + tileColumn[x];
+            dst[x] = (*tiles[index])[(size_t)sampleRow * tile + sampleColumn[x]];
+            stats_.add(dst[x], cached[index]);
+        }
+    }
+    // Итерации — фактически выполненные inner, а не сумма по пикселям вида
+    stats_.iterations = iterations;
+    return true;
+}
+
+// Точки в кэш не попадают: считает inner
+bool CachedEngine::renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                                std::vector<float> &smooth) {
+    inner_->setFormula(formula_);
+    return inner_->renderPoints(view, points, iter, smooth);
+}
+
+void printTileCacheStats(const TileCache &cache) {
+    uint64_t hits = cache.hits(), misses = cache.misses();
+    std::fprintf(stderr, "tile cache: %llu hits, %llu misses (%.1f%% hit), %.1f MB in memory\n",
+                 (unsigned long long)hits, (unsigned long long)misses,
+                 hits + misses ? 100.0 * hits / (hits + misses) : 0.0, cache.bytes() / 1048576.0);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "engine.h"
+#include "tile_cache.h"
+#include <memory>
+
+// --- Вычислитель поверх кэша плиток ---
+// Вид собирается из плиток квадродерева того уровня, где шаг отсчётов не
+// крупнее пикселя вида: каждый пиксель берёт ближайший отсчёт. Недостающие
+// плитки собираются из четырёх дочерних (отдаление), а если их нет —
+// досчитываются inner одним запуском на общий прямоугольник и кладутся в
+// кэш, так что возврат в уже виденную область обходится без расчёта.
+// Плитки разных формул (setFormula) в кэше не смешиваются.
+// Результат приближённый (отсчёты смещены от центров пикселей меньше чем
+// на шаг), поэтому в createEngines() его нет: инструменты включают его
+// опцией --cache-mb. Кэш хранит только итерации, так что smooth и
+// distance остаются пустыми.
+class CachedEngine : public Engine {
+public:
+    CachedEngine(std::unique_ptr<Engine> inner, std::shared_ptr<TileCache> cache);
+
+    std::string name() const override;
+    Precision precision() const override { return inner_->precision(); }
+    bool render(const View &view, IterationBuffer &out) override;
+    bool renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                      std::vector<float> &smooth) override;
+
+private:
+    std::unique_ptr<Engine> inner_;
+    std::shared_ptr<TileCache> cache_;
+    IterationBuffer missing_;
+};
+
+// Попадания и промахи кэша за запуск — строкой "tile cache: ..." в stderr
+void printTileCacheStats(const TileCache &cache);
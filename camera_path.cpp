@@ -0,0 +1,56 @@
+#include "camera_path.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+bool loadPath(const std::string &path, std::vector<PathKey> &keys, std::string &error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    keys.clear();
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        PathKey key;
+        if (!(fields >> key.time)) continue;  // пустая строка или комментарий
+        std::string ease;
+        if (!(fields >> key.centerX >> key.centerY >> key.zoom >> key.maxIter) || key.zoom <= 0 || key.maxIter <= 0 ||
+            ((fields >> ease) && ease != "ease") || (!keys.empty() && key.time <= keys.back().time)) {
+            error = path + ":" + std::to_string(number) + ": expected 'time centerX centerY zoom maxIter [ease]'"
+                    " with increasing time";
+            return false;
+        }
+        key.ease = ease == "ease";
+        keys.push_back(key);
+    }
+    if (keys.empty()) {
+        error = path + ": no keyframes";
+        return false;
+    }
+    return true;
+}
+
+View pathView(const std::vector<PathKey> &keys, double time) {
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+                                 [](double t, const PathKey &key) { return t < key.time; });
+    const PathKey &a = next == keys.begin() ? keys.front() : *(next - 1);
+    const PathKey &b = next == keys.end() ? keys.back() : *next;
+    double t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 0.0;
+    t = std::min(std::max(t, 0.0), 1.0);
+    if (b.ease) t = t * t * (3 - 2 * t);
+
+    View view;
+    view.zoom = a.zoom * std::pow(b.zoom / a.zoom, t);
+    // Центр идёт пропорционально изменению zoom: при погружении точка
+    // назначения остаётся на том же месте экрана, а не уходит за край, пока
+    // центр догоняет её линейно. Без изменения zoom — обычный сдвиг.
+    double s = std::fabs(b.zoom - a.zoom) > 1e-12 * a.zoom ? (view.zoom - a.zoom) / (b.zoom - a.zoom) : t;
+    view.centerX = a.centerX + (b.centerX - a.centerX) * s;
+    view.centerY = a.centerY + (b.centerY - a.centerY) * s;
+    view.maxIter = (int)std::lround(a.maxIter * std::pow((double)b.maxIter / a.maxIter, t));
+    return view;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "view.h"
+#include <string>
+#include <vector>
+
+// --- Траектория камеры для анимации ---
+// Текстовый файл, ключевой кадр на строку, # — комментарий:
+//   время_с  centerX  centerY  zoom  maxIter  [ease]
+// Между ключами zoom и maxIter меняются экспоненциально (постоянная
+// скорость погружения), центр — пропорционально изменению zoom (при
+// одинаковом zoom — линейно). ease на ключе сглаживает подход к нему
+// (smoothstep по времени отрезка). Времена строго возрастают.
+struct PathKey {
+    double time = 0;
+    double centerX = 0;
+    double centerY = 0;
+    double zoom = 1;
+    int maxIter = 500;
+    bool ease = false;
+};
+
+// false и текст ошибки (с номером строки), если файл не разобран
+bool loadPath(const std::string &path, std::vector<PathKey> &keys, std::string &error);
+
+// Вид в момент time (за краями — крайние ключи); размер кадра не задаёт
+View pathView(const std::vector<PathKey> &keys, double time);
@@ -0,0 +1,265 @@
+#include "cl_engine.h"
+#include "kernel_cache.h"
+#include "trace.h"
+#include <algorithm>
+
+ClEngine::ClEngine(cl_device_id device, bool useFloat) : device_(device), useFloat_(useFloat) {
+    cl_int err;
+    context_ = clCreateContext(nullptr, 1, &device_, nullptr, nullptr, &err);
+    if (err != CL_SUCCESS) {
+        context_ = nullptr;
+        return;
+    }
+    queue_ = clCreateCommandQueue(context_, device_, CL_QUEUE_PROFILING_ENABLE, &err);
+    if (err != CL_SUCCESS) queue_ = nullptr;
+}
+
+ClEngine::~ClEngine() {
+    if (buffer_) clReleaseMemObject(buffer_);
+    if (statsBuffer_) clReleaseMemObject(statsBuffer_);
+    if (smoothBuffer_) clReleaseMemObject(smoothBuffer_);
+    if (distanceBuffer_) clReleaseMemObject(distanceBuffer_);
+    if (pointsBuffer_) clReleaseMemObject(pointsBuffer_);
+    if (histBuffer_) clReleaseMemObject(histBuffer_);
+    if (cdfBuffer_) clReleaseMemObject(cdfBuffer_);
+    if (rgbBuffer_) clReleaseMemObject(rgbBuffer_);
+    releaseHelperKernels();
+    if (kernel_) clReleaseKernel(kernel_);
+    if (program_) clReleaseProgram(program_);
+    if (queue_) clReleaseCommandQueue(queue_);
+    if (context_) clReleaseContext(context_);
+}
+
+std::string ClEngine::name() const {
+    return std::string(useFloat_ ? "cl-float " : "cl-double ") + deviceString(device_, CL_DEVICE_NAME);
+}
+
+// Подбор параметров и сборка ядра при первом кадре; пересборка, если
+// включили или выключили smooth, distance или проверку внутренности или
+// сменили формулу
+bool ClEngine::prepare(const View &view) {
+    // Производную ядро считает только у Mandelbrot
+    bool mandelbrot = formula_.kind == FORMULA_MANDELBROT;
+    bool distance = distance_ && mandelbrot, interior = interior_ && mandelbrot;
+    if (kernel_ && kernelSmooth_ == smooth_ && kernelDistance_ == distance && kernelInterior_ == interior &&
+        kernelFormula_ == formula_)
+        return true;
+    if (kernel_) {
+        releaseHelperKernels();
+        clReleaseKernel(kernel_);
+        clReleaseProgram(program_);
+        kernel_ = nullptr;
+        program_ = nullptr;
+    } else {
+        // mandelbrot_iter — ядро "пиксель на рабочий элемент": размер группы
+        // обычного ядра, а не persistent
+        tune_ = standardTune(autotune(context_, device_, queue_, view.width, view.height));
+    }
+    std::string options = tune_.buildOptions() + " -D SPEC_EARLY_OUT -D SPEC_STRICT_FP" + kernelStatsOptions();
+    if (useFloat_) options += " -D SPEC_FLOAT";
+    if (smooth_) options += " -D SPEC_SMOOTH";
+    if (distance) options += " -D SPEC_DISTANCE";
+    if (interior) options += " -D SPEC_INTERIOR";
+    kernel_ = buildMandelbrot(context_, device_, options, "mandelbrot_iter", program_, formula_);
+    if (!kernel_) return false;
+    kernelSmooth_ = smooth_;
+    kernelDistance_ = distance;
+    kernelInterior_ = interior;
+    kernelFormula_ = formula_;
+    if (statsBuffer_) return true;
+    cl_int err;
+    statsBuffer_ = clCreateBuffer(context_, CL_MEM_READ_WRITE, sizeof(cl_uint) * KERNEL_STATS_WORDS, nullptr, &err);
+    if (err != CL_SUCCESS) statsBuffer_ = nullptr;
+    return statsBuffer_ != nullptr;
+}
+
+void ClEngine::releaseHelperKernels() {
+    for (cl_kernel *kernel : {&pointsKernel_, &histogramKernel_, &cdfKernel_, &mapKernel_}) {
+        if (*kernel) clReleaseKernel(*kernel);
+        *kernel = nullptr;
+    }
+}
+
+bool ClEngine::ensureBuffer(cl_mem &buffer, size_t &capacity, size_t size) {
+    if (size <= capacity) return true;
+    if (buffer) clReleaseMemObject(buffer);
+    cl_int err;
+    // READ_WRITE: буфер итераций читают ядра equalize()
+    buffer = clCreateBuffer(context_, CL_MEM_READ_WRITE, size, nullptr, &err);
+    capacity = err == CL_SUCCESS ? size : 0;
+    if (err != CL_SUCCESS) buffer = nullptr;
+    return buffer != nullptr;
+}
+
+bool ClEngine::render(const View &view, IterationBuffer &out) {
+    if (!ready() || !prepare(view)) return false;
+    TRACE_SPAN("cl render");
+
+    out.resize(view.width, view.height, smooth_, kernelDistance_);
+    size_t size = sizeof(cl_uint) * out.iter.size();
+    if (!ensureBuffer(buffer_, bufferSize_, size)) return false;
+    // После stats (аргумент 8, его выставляет enqueueFrame)
+    cl_uint arg = 9;
+    if (smooth_) {
+        if (!ensureBuffer(smoothBuffer_, smoothSize_, sizeof(cl_float) * out.smooth.size())) return false;
+        clSetKernelArg(kernel_, arg++, sizeof(cl_mem), &smoothBuffer_);
+    }
+    if (kernelDistance_) {
+        if (!ensureBuffer(distanceBuffer_, distanceSize_, sizeof(cl_float) * out.distance.size())) return false;
+        clSetKernelArg(kernel_, arg++, sizeof(cl_mem), &distanceBuffer_);
+    }
+
+    setMandelbrotArgs(kernel_, buffer_, view.width, view.height, view.centerX, view.centerY, view.zoom, view.maxIter,
+                      0);
+    if (enqueueFrame(queue_, kernel_, device_, tune_, view.width, view.height, nullptr, nullptr, statsBuffer_) !=
+        CL_SUCCESS)
+        return false;
+
+    // Очередь упорядоченная: блокирующее чтение итераций дожидается и статистики
+    cl_uint words[KERNEL_STATS_WORDS];
+    clEnqueueReadBuffer(queue_, statsBuffer_, CL_FALSE, 0, sizeof(words), words, 0, nullptr, nullptr);
+    if (smooth_ && clEnqueueReadBuffer(queue_, smoothBuffer_, CL_FALSE, 0, sizeof(cl_float) * out.smooth.size(),
+                                       out.smooth.data(), 0, nullptr, nullptr) != CL_SUCCESS)
+        return false;
+    if (kernelDistance_ &&
+        clEnqueueReadBuffer(queue_, distanceBuffer_, CL_FALSE, 0, sizeof(cl_float) * out.distance.size(),
+                            out.distance.data(), 0, nullptr, nullptr) != CL_SUCCESS)
+        return false;
+    if (clEnqueueReadBuffer(queue_, buffer_, CL_TRUE, 0, size, out.iter.data(), 0, nullptr, nullptr) != CL_SUCCESS)
+        return false;
+    stats_ = kernelStats(words, out.iter.size(), view.maxIter);
+    return true;
+}
+
+bool ClEngine::renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                            std::vector<float> &smooth) {
+    if (!ready() || !prepare(view)) return false;
+    TRACE_SPAN("cl points");
+    cl_int err = CL_SUCCESS;
+    if (!pointsKernel_) {
+        pointsKernel_ = clCreateKernel(program_, "mandelbrot_points", &err);
+        if (err != CL_SUCCESS) {
+            pointsKernel_ = nullptr;
+            return false;
+        }
+    }
+    cl_int count = (cl_int)(points.size() / 2);
+    iter.resize(count);
+    smooth.resize(count);
+    if (count == 0) return true;
+    // Выходы — в буферы кадра: render и renderPoints не идут одновременно
+    if (!ensureBuffer(pointsBuffer_, pointsSize_, sizeof(cl_double) * 2 * count) ||
+        !ensureBuffer(buffer_, bufferSize_, sizeof(cl_uint) * count) ||
+        !ensureBuffer(smoothBuffer_, smoothSize_, sizeof(cl_float) * count))
+        return false;
+    clEnqueueWriteBuffer(queue_, pointsBuffer_, CL_FALSE, 0, sizeof(cl_double) * 2 * count, points.data(), 0, nullptr,
+                         nullptr);
+    clSetKernelArg(pointsKernel_, 0, sizeof(cl_mem), &pointsBuffer_);
+    clSetKernelArg(pointsKernel_, 1, sizeof(cl_int), &count);
+    clSetKernelArg(pointsKernel_, 2, sizeof(cl_int), &view.maxIter);
+    clSetKernelArg(pointsKernel_, 3, sizeof(cl_mem), &buffer_);
+    clSetKernelArg(pointsKernel_, 4, sizeof(cl_mem), &smoothBuffer_);
+    size_t global = count;
+    err = clEnqueueNDRangeKernel(queue_, pointsKernel_, 1, nullptr, &global, nullptr, 0, nullptr, nullptr);
+    if (err == CL_SUCCESS)
+        err = clEnqueueReadBuffer(queue_, smoothBuffer_, CL_FALSE, 0, sizeof(cl_float) * count, smooth.data(), 0,
+                                  nullptr, nullptr);
+    if (err == CL_SUCCESS)
+        err = clEnqueueReadBuffer(queue_, buffer_, CL_TRUE, 0, sizeof(cl_uint) * count, iter.data(), 0, nullptr,
+                                  nullptr);
+    if (err != CL_SUCCESS) clFinish(queue_);
+    return err == CL_SUCCESS;
+}
+
+bool ClEngine::equalize(const IterationBuffer &in, int maxIter, std::vector<uint8_t> &rgb) {
+    if (!ready() || !program_) return false;
+    TRACE_SPAN("cl equalize");
+    if (!histogramKernel_) {
+        cl_int errs[3];
+        histogramKernel_ = clCreateKernel(program_, "iter_histogram", &errs[0]);
+        cdfKernel_ = clCreateKernel(program_, "histogram_cdf", &errs[1]);
+        mapKernel_ = clCreateKernel(program_, "histogram_map", &errs[2]);
+        if (errs[0] != CL_SUCCESS || errs[1] != CL_SUCCESS || errs[2] != CL_SUCCESS) {
+            releaseHelperKernels();
+            return false;
+        }
+    }
+
+    // Итерации копируются заново: in не обязательно последний кадр render()
+    cl_int count = (cl_int)in.iter.size();
+    size_t bins = (size_t)maxIter + 1;
+    if (!ensureBuffer(buffer_, bufferSize_, sizeof(cl_uint) * count) ||
+        !ensureBuffer(histBuffer_, histSize_, sizeof(cl_uint) * bins) ||
+        !ensureBuffer(cdfBuffer_, cdfSize_, sizeof(cl_float) * bins) ||
+        !ensureBuffer(rgbBuffer_, rgbSize_, 3 * (size_t)count))
+        return false;
+    cl_event events[5] = {};
+    clEnqueueWriteBuffer(queue_, buffer_, CL_FALSE, 0, sizeof(cl_uint) * count, in.iter.data(), 0, nullptr,
+                         &events[0]);
+    cl_uint zero = 0;
+    clEnqueueFillBuffer(queue_, histBuffer_, &zero, sizeof(zero), 0, sizeof(cl_uint) * bins, 0, nullptr, nullptr);
+
+    // --- Гистограмма: по несколько групп на вычислительный блок ---
+    size_t maxGroup = 0;
+    clGetKernelWorkGroupInfo(histogramKernel_, device_, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup,
+                             nullptr);
+    cl_uint units = 1;
+    clGetDeviceInfo(device_, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, nullptr);
+    size_t local = std::min<size_t>(256, maxGroup);
+    size_t global = local * units * 4;
+    clSetKernelArg(histogramKernel_, 0, sizeof(cl_mem), &buffer_);
+    clSetKernelArg(histogramKernel_, 1, sizeof(cl_int), &count);
+    clSetKernelArg(histogramKernel_, 2, sizeof(cl_int), &maxIter);
+    clSetKernelArg(histogramKernel_, 3, sizeof(cl_mem), &histBuffer_);
+    cl_int err = clEnqueueNDRangeKernel(queue_, histogramKernel_, 1, nullptr, &global, &local, 0, nullptr, &events[1]);
+
+    // --- CDF: одна группа (HIST_SCAN_GROUP в ядре) ---
+    clGetKernelWorkGroupInfo(cdfKernel_, device_, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup, nullptr);
+    size_t scanLocal = std::min<size_t>(256, maxGroup);
+    clSetKernelArg(cdfKernel_, 0, sizeof(cl_mem), &histBuffer_);
+    clSetKernelArg(cdfKernel_, 1, sizeof(cl_int), &maxIter);
+    clSetKernelArg(cdfKernel_, 2, sizeof(cl_mem), &cdfBuffer_);
+    if (err == CL_SUCCESS)
+        err = clEnqueueNDRangeKernel(queue_, cdfKernel_, 1, nullptr, &scanLocal, &scanLocal, 0, nullptr, &events[2]);
+
+    // --- Раскраска: пиксель на элемент ---
+    size_t pixels = count;
+    clSetKernelArg(mapKernel_, 0, sizeof(cl_mem), &buffer_);
+    clSetKernelArg(mapKernel_, 1, sizeof(cl_int), &count);
+    clSetKernelArg(mapKernel_, 2, sizeof(cl_int), &maxIter);
+    clSetKernelArg(mapKernel_, 3, sizeof(cl_mem), &cdfBuffer_);
+    clSetKernelArg(mapKernel_, 4, sizeof(cl_mem), &rgbBuffer_);
+    if (err == CL_SUCCESS)
+        err = clEnqueueNDRangeKernel(queue_, mapKernel_, 1, nullptr, &pixels, nullptr, 0, nullptr, &events[3]);
+
+    rgb.resize(3 * (size_t)count);
+    if (err == CL_SUCCESS)
+        err = clEnqueueReadBuffer(queue_, rgbBuffer_, CL_TRUE, 0, rgb.size(), rgb.data(), 0, nullptr, &events[4]);
+    if (err == CL_SUCCESS) {
+        equalizeStats_.uploadMs = events[0] ? eventMs(events[0]) : 0;
+        equalizeStats_.histogramMs = eventMs(events[1]);
+        equalizeStats_.cdfMs = eventMs(events[2]);
+        equalizeStats_.mapMs = eventMs(events[3]);
+        equalizeStats_.readbackMs = eventMs(events[4]);
+    }
+    if (err != CL_SUCCESS) clFinish(queue_);
+    for (cl_event event : events)
+        if (event) clReleaseEvent(event);
+    return err == CL_SUCCESS;
+}
+
+std::vector<cl_device_id> allClDevices() {
+    std::vector<cl_device_id> devices;
+    cl_uint platformCount = 0;
+    if (clGetPlatformIDs(0, nullptr, &platformCount) != CL_SUCCESS || platformCount == 0) return devices;
+    std::vector<cl_platform_id> platforms(platformCount);
+    clGetPlatformIDs(platformCount, platforms.data(), nullptr);
+    for (cl_platform_id platform : platforms) {
+        cl_uint count = 0;
+        if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr, &count) != CL_SUCCESS || count == 0) continue;
+        size_t first = devices.size();
+        devices.resize(first + count);
+        clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, count, &devices[first], nullptr);
+    }
+    return devices;
+}
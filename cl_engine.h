@@ -0,0 +1,68 @@
+#pragma once
+#include "autotune.h"
+#include "cl_utils.h"
+#include "engine.h"
+#include <vector>
+
+// --- Расчёт ядром mandelbrot_iter на одном OpenCL устройстве ---
+// Параметры запуска берутся у автотюнера при первом кадре. useFloat —
+// итерации во float (SPEC_FLOAT), иначе double.
+class ClEngine : public Engine {
+public:
+    ClEngine(cl_device_id device, bool useFloat);
+    ~ClEngine() override;
+
+    // false, если не удалось создать контекст или очередь
+    bool ready() const { return queue_ != nullptr; }
+
+    std::string name() const override;
+    Precision precision() const override { return useFloat_ ? PRECISION_FLOAT : PRECISION_DOUBLE; }
+    bool render(const View &view, IterationBuffer &out) override;
+    bool renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                      std::vector<float> &smooth) override;
+    // Ядрами iter_histogram, histogram_cdf и histogram_map; нужен хотя бы
+    // один render() до этого (ядра берутся из его программы)
+    bool equalize(const IterationBuffer &in, int maxIter, std::vector<uint8_t> &rgb) override;
+
+private:
+    bool prepare(const View &view);
+    // Ядра renderPoints() и equalize() из программы program_
+    void releaseHelperKernels();
+    // Буфер на size байт: переиспользуется, пока хватает
+    bool ensureBuffer(cl_mem &buffer, size_t &capacity, size_t size);
+
+    cl_device_id device_;
+    bool useFloat_;
+    cl_context context_ = nullptr;
+    cl_command_queue queue_ = nullptr;
+    cl_program program_ = nullptr;
+    cl_kernel kernel_ = nullptr;
+    cl_mem buffer_ = nullptr;
+    size_t bufferSize_ = 0;
+    cl_mem statsBuffer_ = nullptr;
+    cl_mem smoothBuffer_ = nullptr;
+    size_t smoothSize_ = 0;
+    cl_mem distanceBuffer_ = nullptr;
+    size_t distanceSize_ = 0;
+    bool kernelSmooth_ = false;    // собрано ли ядро с SPEC_SMOOTH
+    bool kernelDistance_ = false;  // и с SPEC_DISTANCE
+    bool kernelInterior_ = false;  // и с SPEC_INTERIOR
+    Formula kernelFormula_;        // и с этой формулой
+    cl_kernel pointsKernel_ = nullptr;  // при первом renderPoints()
+    cl_mem pointsBuffer_ = nullptr;
+    size_t pointsSize_ = 0;
+    // Выравнивание гистограммы: ядра создаются при первом equalize()
+    cl_kernel histogramKernel_ = nullptr;
+    cl_kernel cdfKernel_ = nullptr;
+    cl_kernel mapKernel_ = nullptr;
+    cl_mem histBuffer_ = nullptr;
+    size_t histSize_ = 0;
+    cl_mem cdfBuffer_ = nullptr;
+    size_t cdfSize_ = 0;
+    cl_mem rgbBuffer_ = nullptr;
+    size_t rgbSize_ = 0;
+    TuneConfig tune_;
+};
+
+// Все OpenCL устройства всех платформ
+std::vector<cl_device_id> allClDevices();
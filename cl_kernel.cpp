@@ -0,0 +1,594 @@
+#include "cl_kernel.h"
+
+// --- OpenCL ядро ---
+const char *mandelbrotKernel = R"(
+#ifdef cl_khr_fp64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#elif defined(cl_amd_fp64)
+#pragma OPENCL EXTENSION cl_amd_fp64 : enable
+#else
+#error "Double precision floating point not supported by OpenCL implementation."
+#endif
+
+#ifdef SPEC_STRICT_FP
+// Без слияния в fma: результат совпадает с CPU бит в бит
+#pragma OPENCL FP_CONTRACT OFF
+#endif
+
+#ifdef SPEC_FLOAT
+typedef float real_t;
+#else
+typedef double real_t;
+#endif
+
+#ifdef SPEC_MAX_ITER
+#define MAX_ITER SPEC_MAX_ITER
+#else
+#define MAX_ITER maxIter
+#endif
+#ifdef SPEC_WIDTH
+#define WIDTH SPEC_WIDTH
+#else
+#define WIDTH width
+#endif
+#ifdef SPEC_HEIGHT
+#define HEIGHT SPEC_HEIGHT
+#else
+#define HEIGHT height
+#endif
+#ifdef SPEC_COLOR_MODE
+#define COLOR_MODE SPEC_COLOR_MODE
+#else
+#define COLOR_MODE colorMode
+#endif
+
+// Формула итераций: formulaKernelSource (formula.h) перед ядром задаёт
+// FORMULA (FormulaKind), начало орбиты FORMULA_INIT(real, imag) и шаг
+// FORMULA_STEP над zr, zi, cr, ci; без неё — Mandelbrot
+#ifndef FORMULA
+#define FORMULA 0
+#define FORMULA_LOG2_POWER 1.0f
+#define FORMULA_INIT(real, imag) { zr = 0; zi = 0; cr = real; ci = imag; }
+#define FORMULA_STEP { real_t tmp = zr*zr - zi*zi + cr; zi = (real_t)2.0*zr*zi + ci; zr = tmp; }
+#endif
+// Ранний выход, оценка расстояния и проверка внутренности знают только
+// множество Мандельброта
+#define FORMULA_IS_MANDELBROT (FORMULA == 0)
+#if !FORMULA_IS_MANDELBROT && (defined(SPEC_DISTANCE) || defined(SPEC_INTERIOR))
+#error "SPEC_DISTANCE and SPEC_INTERIOR need the Mandelbrot formula"
+#endif
+#if FORMULA_IS_MANDELBROT && defined(SPEC_EARLY_OUT)
+#define EARLY_OUT
+#endif
+
+// Главная кардиоида и круг периода 2: точки внутри не убегают никогда
+bool inMainBulbs(real_t real, real_t imag) {
+    real_t xq = real - (real_t)0.25;
+    real_t q = xq*xq + imag*imag;
+    if (q*(q + xq) <= (real_t)0.25*imag*imag) return true;
+    real_t xb = real + (real_t)1.0;
+    return xb*xb + imag*imag <= (real_t)0.0625;
+}
+
+// Один шаг с проверкой выхода; break выходит из охватывающего цикла
+#define ESCAPE_STEP { \
+    if (zr*zr + zi*zi >= (real_t)4.0) break; \
+    FORMULA_STEP \
+    iter++; }
+#define REPEAT_2(S) S S
+#define REPEAT_4(S) REPEAT_2(S) REPEAT_2(S)
+#define REPEAT_8(S) REPEAT_4(S) REPEAT_4(S)
+#define REPEAT_16(S) REPEAT_8(S) REPEAT_8(S)
+#define REPEAT_N(N, S) REPEAT_##N(S)
+#define REPEAT(N, S) REPEAT_N(N, S)
+
+#ifdef SPEC_INTERIOR
+#ifndef INTERIOR_EPS2
+#define INTERIOR_EPS2 1e-6
+#endif
+// Рядом с z идёт производная dz_n/dz_1 (произведение 2*z по орбите). У
+// точки, притянутой к циклу, она убывает геометрически: как только
+// |dz|^2 < INTERIOR_EPS2, точка внутри, и счёт останавливается с
+// результатом maxIter. Ложных срабатываний на эталонных видах нет и при
+// пороге в 1000 раз больше (bench --interior).
+#define INTERIOR_STEP(iter) { \
+    real_t tmpD = (real_t)2.0*(zr*dzr - zi*dzi); \
+    dzi = (real_t)2.0*(zr*dzi + zi*dzr); \
+    dzr = tmpD; \
+    real_t tmp = zr*zr - zi*zi + real; \
+    zi = (real_t)2.0*zr*zi + imag; \
+    zr = tmp; \
+    iter++; }
+#define INTERIOR_FOUND (dzr*dzr + dzi*dzi < (real_t)INTERIOR_EPS2)
+#endif
+
+// skipped — точку отсёк ранний выход, итерации не выполнялись;
+// interiorAt — на какой итерации точку признала внутренней проверка
+// производной (SPEC_INTERIOR), 0 — не признала;
+// norm — |z|^2 в момент выхода (для дробного числа итераций)
+int iterate(real_t real, real_t imag, int maxIter, bool *skipped, int *interiorAt, real_t *norm) {
+    *skipped = false;
+    *interiorAt = 0;
+    *norm = 0;
+#ifdef EARLY_OUT
+    if (inMainBulbs(real, imag)) {
+        *skipped = true;
+        return maxIter;
+    }
+#endif
+#ifdef SPEC_INTERIOR
+    // Производная нужна на каждом шаге: без блоков и развёртки. Первый шаг
+    // из z = 0 даёт z = c, производная отсчитывается от него.
+    if (maxIter <= 0) return 0;
+    real_t zr = real, zi = imag, dzr = 1, dzi = 0;
+    int iter = 1;
+    while(zr*zr + zi*zi < (real_t)4.0 && iter < maxIter){
+        INTERIOR_STEP(iter)
+        if (INTERIOR_FOUND) {
+            *interiorAt = iter;
+            return maxIter;
+        }
+    }
+    *norm = zr*zr + zi*zi;
+    return iter;
+#else
+    real_t zr, zi, cr, ci;
+    FORMULA_INIT(real, imag)
+    int iter = 0;
+#if defined(SPEC_ITER_BLOCK) && SPEC_ITER_BLOCK > 1
+    // Блоки по SPEC_ITER_BLOCK итераций без проверки выхода. Убежавшая
+    // точка (|z| > 2) уже не возвращается в круг, так что достаточно проверить
+    // конец блока; тогда откатываемся к состоянию перед блоком, и обычный
+    // цикл ниже доигрывает его с проверкой на каждом шаге — счётчик точный.
+    // Переполнение до inf/nan проверка !(< 4) тоже ловит.
+    while (iter + SPEC_ITER_BLOCK <= maxIter) {
+        real_t savedR = zr, savedI = zi;
+        for (int k = 0; k < SPEC_ITER_BLOCK; k++) FORMULA_STEP
+        if (!(zr*zr + zi*zi < (real_t)4.0)) {
+            zr = savedR;
+            zi = savedI;
+            break;
+        }
+        iter += SPEC_ITER_BLOCK;
+    }
+#elif defined(SPEC_UNROLL) && SPEC_UNROLL > 1
+    // Развёрнутый цикл: счётчик проверяется раз в SPEC_UNROLL шагов,
+    // остаток добирает обычный цикл ниже
+    while (iter + SPEC_UNROLL <= maxIter) {
+        REPEAT(SPEC_UNROLL, ESCAPE_STEP)
+    }
+#endif
+    while(zr*zr + zi*zi < (real_t)4.0 && iter < maxIter){
+        FORMULA_STEP
+        iter++;
+    }
+    *norm = zr*zr + zi*zi;
+    return iter;
+#endif
+}
+
+#ifdef SPEC_DISTANCE
+#ifndef DE_EXTRA_STEPS
+#define DE_EXTRA_STEPS 4
+#endif
+// Как iterate, но с производной dz/dc (dz' = 2*z*dz + 1) в регистрах рядом
+// с z; блоков и развёртки нет — производная нужна на каждом шаге. distance —
+// оценка расстояния до множества |z| ln|z| / (2 |dz|) в единицах
+// комплексной плоскости, 0 внутри. Счётчик итераций тот же, что у iterate
+// (выход по |z| > 2), но оценке нужен большой |z|, поэтому после выхода
+// делается до DE_EXTRA_STEPS шагов (|z| растёт как квадрат: 2 -> 65536).
+int iterateDistance(real_t real, real_t imag, int maxIter, bool *skipped, real_t *norm, real_t *distance) {
+    *skipped = false;
+    *norm = 0;
+    *distance = 0;
+#ifdef EARLY_OUT
+    if (inMainBulbs(real, imag)) {
+        *skipped = true;
+        return maxIter;
+    }
+#endif
+    real_t zr = 0, zi = 0, dzr = 0, dzi = 0;
+    int iter = 0;
+    while(zr*zr + zi*zi < (real_t)4.0 && iter < maxIter){
+        real_t tmpD = (real_t)2.0*(zr*dzr - zi*dzi) + (real_t)1.0;
+        dzi = (real_t)2.0*(zr*dzi + zi*dzr);
+        dzr = tmpD;
+        real_t tmp = zr*zr - zi*zi + real;
+        zi = (real_t)2.0*zr*zi + imag;
+        zr = tmp;
+        iter++;
+    }
+    *norm = zr*zr + zi*zi;
+    if (iter >= maxIter) return iter;
+    for (int k = 0; k < DE_EXTRA_STEPS && zr*zr + zi*zi < (real_t)1e8; k++) {
+        real_t tmpD = (real_t)2.0*(zr*dzr - zi*dzi);
+        dzi = (real_t)2.0*(zr*dzi + zi*dzr);
+        dzr = tmpD;
+        real_t tmp = zr*zr - zi*zi + real;
+        zi = (real_t)2.0*zr*zi + imag;
+        zr = tmp;
+    }
+    real_t z2 = zr*zr + zi*zi;
+    real_t dz2 = dzr*dzr + dzi*dzi;
+    *distance = (real_t)0.25 * sqrt(z2 / dz2) * log(z2);
+    return iter;
+}
+#endif
+
+// Дробное число итераций: непрерывно по пикселям, без полос палитры
+float smoothIter(int iter, int maxIter, real_t norm) {
+    if (iter >= maxIter) return (float)maxIter;
+    return iter + 1 - log2(log2((float)norm) * 0.5f) / FORMULA_LOG2_POWER;
+}
+
+float3 hsv2rgb(float3 c) {
+    float3 k = c.xxx + (float3)(1.0f, 2.0f/3.0f, 1.0f/3.0f);
+    float3 p = fabs((k - floor(k)) * 6.0f - 3.0f);
+    return c.z * mix((float3)(1.0f), clamp(p - 1.0f, 0.0f, 1.0f), c.y);
+}
+
+// norm нужен только COLOR_SMOOTH
+uchar4 colorize(int iter, real_t norm, int maxIter, int colorMode) {
+    if (colorMode == 2) {
+        // COLOR_SMOOTH: одно чтение из __constant таблицы (paletteKernelSource)
+        if (iter >= maxIter) return (uchar4)(0,0,0,255);
+        // fmax до приведения: у норм чуть выше радиуса бегства smoothIter
+        // бывает отрицательным, а (uint) от отрицательного float — UB
+        return PALETTE[(uint)fmax(smoothIter(iter, maxIter, norm) * PALETTE_SCALE, 0.0f) & (PALETTE_SIZE - 1)];
+    }
+    float t = (float)iter / maxIter;
+    if (colorMode == 1) {
+        // COLOR_HSV: та же схема, что и в shader.glsl
+        if (iter == maxIter) return (uchar4)(0,0,0,255);
+        float3 c = hsv2rgb((float3)(t * 6.0f + 0.1f, 0.8f, 1.0f));
+        return (uchar4)((uchar)(c.x*255), (uchar)(c.y*255), (uchar)(c.z*255), 255);
+    }
+    uchar r = (uchar)(9*(1-t)*t*t*t*255);
+    uchar g = (uchar)(15*(1-t)*(1-t)*t*t*255);
+    uchar b = (uchar)(8.5*(1-t)*(1-t)*(1-t)*t*255);
+    return (uchar4)(r,g,b,255);
+}
+
+#ifdef SPEC_STATS
+#ifndef STATS_BINS
+#define STATS_BINS 64
+#endif
+// Слова буфера статистики (раскладка — см. kernelStats, смысл — WorkStats)
+#define STATS_ITER_LO 0
+#define STATS_ITER_HI 1
+#define STATS_ESCAPED 2
+#define STATS_SKIPPED 3
+#define STATS_INTERIOR 4
+#define STATS_HIST 5
+#define STATS_WORDS (STATS_HIST + STATS_BINS)
+
+// 64-битная сумма на 32-битных атомиках: перенос — когда старое + v < v
+#define ATOMIC_ADD_WIDE(lo, hi, v) { \
+    uint value_ = (v); \
+    if (atomic_add(lo, value_) + value_ < value_) atomic_inc(hi); }
+
+// Группа копит счётчики и гистограмму в локальной памяти и в конце сливает
+// их в глобальный буфер stats одним атомиком на слово. Между STATS_BEGIN и
+// STATS_END не должно быть return: барьер обязаны пройти все элементы.
+#define STATS_ARG , __global uint* stats
+#define STATS_BEGIN \
+    __local uint groupStats[STATS_WORDS]; \
+    int statsLid = get_local_id(1) * get_local_size(0) + get_local_id(0); \
+    int statsGroupSize = get_local_size(0) * get_local_size(1); \
+    for (int i = statsLid; i < STATS_WORDS; i += statsGroupSize) groupStats[i] = 0; \
+    barrier(CLK_LOCAL_MEM_FENCE);
+// interiorAt — см. iterate: выполнено столько итераций, а не iter
+#define STATS_ADD(iter, skipped, interiorAt) { \
+    if (skipped) { \
+        atomic_inc(&groupStats[STATS_SKIPPED]); \
+    } else { \
+        ATOMIC_ADD_WIDE(&groupStats[STATS_ITER_LO], &groupStats[STATS_ITER_HI], (interiorAt) ? (interiorAt) : (iter)) \
+    } \
+    if (interiorAt) atomic_inc(&groupStats[STATS_INTERIOR]); \
+    if ((iter) < MAX_ITER) atomic_inc(&groupStats[STATS_ESCAPED]); \
+    atomic_inc(&groupStats[STATS_HIST + (int)((ulong)(iter) * STATS_BINS / (MAX_ITER + 1))]); }
+#define STATS_END \
+    barrier(CLK_LOCAL_MEM_FENCE); \
+    for (int i = statsLid; i < STATS_WORDS; i += statsGroupSize) { \
+        uint value = groupStats[i]; \
+        if (!value) continue; \
+        if (i == STATS_ITER_LO) { \
+            ATOMIC_ADD_WIDE(&stats[STATS_ITER_LO], &stats[STATS_ITER_HI], value) \
+        } else { \
+            atomic_add(&stats[i], value); \
+        } \
+    }
+#else
+#define STATS_ARG
+#define STATS_BEGIN
+#define STATS_ADD(iter, skipped, interiorAt)
+#define STATS_END
+#endif
+
+// С SPEC_STATS у каждого ядра последний аргумент — stats (STATS_WORDS
+// обнулённых uint), см. enqueueFrame.
+__kernel void mandelbrot(
+    __global uchar4* image,
+    const int width,
+    const int height,
+    const double centerX,
+    const double centerY,
+    const double zoom,
+    const int maxIter,
+    const int colorMode
+    STATS_ARG)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    STATS_BEGIN
+    // глобальный размер округлён вверх до кратного размеру рабочей группы
+    if (x < WIDTH && y < HEIGHT) {
+        double scale = zoom / (double)HEIGHT;
+        double real = centerX + (x - WIDTH/2.0) * scale;
+        double imag = centerY + (y - HEIGHT/2.0) * scale;
+        bool skipped;
+        int interiorAt;
+        real_t norm;
+        int iter = iterate((real_t)real, (real_t)imag, MAX_ITER, &skipped, &interiorAt, &norm);
+        image[y*WIDTH + x] = colorize(iter, norm, MAX_ITER, COLOR_MODE);
+        STATS_ADD(iter, skipped, interiorAt)
+    }
+    STATS_END
+}
+
+#ifdef SPEC_SMOOTH
+// Дробное число итераций в отдельный буфер: аргумент после stats
+#define SMOOTH_ARG , __global float* smooth
+#define SMOOTH_STORE(i, iter, norm) smooth[i] = smoothIter(iter, MAX_ITER, norm);
+#else
+#define SMOOTH_ARG
+#define SMOOTH_STORE(i, iter, norm)
+#endif
+
+#ifdef SPEC_DISTANCE
+// Оценка расстояния в пикселях в отдельный буфер: аргумент после smooth
+// (или после stats, если SPEC_SMOOTH нет)
+#define DISTANCE_ARG , __global float* distance
+#define ITERATE(real, imag, skipped, interiorAt, norm) \
+    (*(interiorAt) = 0, iterateDistance(real, imag, MAX_ITER, skipped, norm, &pixelDistance))
+#define DISTANCE_STORE(i, scale) distance[i] = (float)(pixelDistance / scale);
+#else
+#define DISTANCE_ARG
+#define ITERATE(real, imag, skipped, interiorAt, norm) iterate(real, imag, MAX_ITER, skipped, interiorAt, norm)
+#define DISTANCE_STORE(i, scale)
+#endif
+
+// Число итераций без раскраски (для бенчмарка, тестов и CPU-постобработки).
+// Сигнатура та же, что у mandelbrot; colorMode не используется.
+__kernel void mandelbrot_iter(
+    __global uint* iters,
+    const int width,
+    const int height,
+    const double centerX,
+    const double centerY,
+    const double zoom,
+    const int maxIter,
+    const int colorMode
+    STATS_ARG
+    SMOOTH_ARG
+    DISTANCE_ARG)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    STATS_BEGIN
+    if (x < WIDTH && y < HEIGHT) {
+        double scale = zoom / (double)HEIGHT;
+        double real = centerX + (x - WIDTH/2.0) * scale;
+        double imag = centerY + (y - HEIGHT/2.0) * scale;
+        bool skipped;
+        int interiorAt;
+        real_t norm, pixelDistance;
+        int iter = ITERATE((real_t)real, (real_t)imag, &skipped, &interiorAt, &norm);
+        iters[y*WIDTH + x] = iter;
+        SMOOTH_STORE(y*WIDTH + x, iter, norm)
+        DISTANCE_STORE(y*WIDTH + x, scale)
+        STATS_ADD(iter, skipped, interiorAt)
+    }
+    STATS_END
+}
+
+// Отдельные точки плоскости (дополнительные отсчёты сглаживания,
+// antialias.h): points — пары (re, im), на выходе число итераций и дробное
+// число итераций. maxIter всегда аргументом: SPEC_MAX_ITER не действует.
+__kernel void mandelbrot_points(
+    __global const double* points,
+    const int count,
+    const int maxIter,
+    __global uint* iters,
+    __global float* smooth)
+{
+    int i = get_global_id(0);
+    if (i >= count) return;
+    bool skipped;
+    int interiorAt;
+    real_t norm;
+    int iter = iterate((real_t)points[2*i], (real_t)points[2*i + 1], maxIter, &skipped, &interiorAt, &norm);
+    iters[i] = iter;
+    smooth[i] = smoothIter(iter, maxIter, norm);
+}
+
+#ifndef PERSIST_BATCH
+#define PERSIST_BATCH 16
+#endif
+#ifndef PERSIST_CHUNK
+#define PERSIST_CHUNK 64
+#endif
+
+// Вариант с постоянными потоками: фиксированное число рабочих групп
+// разбирает пиксели пачками по PERSIST_BATCH через атомарный счётчик.
+// Итерации идут порциями по PERSIST_CHUNK; поток, чей пиксель уже убежал,
+// сразу берёт следующий, так что соседи по волне не простаивают, пока
+// кто-то один досчитывает до maxIter. counter перед запуском обнуляется.
+__kernel void mandelbrot_persistent(
+    __global uchar4* image,
+    const int width,
+    const int height,
+    const double centerX,
+    const double centerY,
+    const double zoom,
+    const int maxIter,
+    const int colorMode,
+    __global int* counter
+    STATS_ARG)
+{
+    STATS_BEGIN
+    int total = WIDTH * HEIGHT;
+    double scale = zoom / (double)HEIGHT;
+    int next = 0, end = 0;  // текущая пачка пикселей [next, end)
+    int pixel = -1;
+    real_t real = 0, imag = 0, zr = 0, zi = 0, cr = 0, ci = 0;
+    int iter = 0, interiorAt = 0;
+    bool skipped = false;
+#ifdef SPEC_INTERIOR
+    real_t dzr = 0, dzi = 0;
+#endif
+    while (true) {
+        if (pixel < 0) {
+            if (next == end) {
+                next = atomic_add(counter, PERSIST_BATCH);
+                if (next >= total) break;
+                end = min(next + PERSIST_BATCH, total);
+            }
+            pixel = next++;
+            int x = pixel % WIDTH;
+            int y = pixel / WIDTH;
+            real = (real_t)(centerX + (x - WIDTH/2.0) * scale);
+            imag = (real_t)(centerY + (y - HEIGHT/2.0) * scale);
+#ifdef SPEC_INTERIOR
+            // Первый шаг сразу (как в iterate): z = c, dz = 1
+            zr = real;
+            zi = imag;
+            dzr = 1;
+            dzi = 0;
+            iter = min(1, MAX_ITER);
+#else
+            FORMULA_INIT(real, imag)
+            iter = 0;
+#endif
+            interiorAt = 0;
+            skipped = false;
+#ifdef EARLY_OUT
+            skipped = inMainBulbs(real, imag);
+            if (skipped) iter = MAX_ITER;
+#endif
+        }
+        int limit = min(iter + PERSIST_CHUNK, MAX_ITER);
+#ifdef SPEC_INTERIOR
+        while(zr*zr + zi*zi < (real_t)4.0 && iter < limit){
+            INTERIOR_STEP(iter)
+            if (INTERIOR_FOUND) {
+                interiorAt = iter;
+                iter = MAX_ITER;
+                break;
+            }
+        }
+#else
+        while(zr*zr + zi*zi < (real_t)4.0 && iter < limit){
+            FORMULA_STEP
+            iter++;
+        }
+#endif
+        if (iter < limit || iter == MAX_ITER) {
+            image[pixel] = colorize(iter, zr*zr + zi*zi, MAX_ITER, COLOR_MODE);
+            STATS_ADD(iter, skipped, interiorAt)
+            pixel = -1;
+        }
+    }
+    STATS_END
+}
+
+// --- Выравнивание гистограммы (ClEngine::equalize, histogram_color.h) ---
+// Три прохода над готовым буфером итераций: гистограмма, префиксная сумма
+// в CDF и раскраска по CDF.
+#define HIST_LOCAL_BINS 4096
+#define HIST_SCAN_GROUP 256
+
+// Каждая группа копит свою гистограмму в локальной памяти и сливает её в
+// hist одним атомиком на непустую корзину; если корзин больше
+// HIST_LOCAL_BINS, атомики сразу глобальные. Запускается меньше элементов,
+// чем пикселей: каждый проходит буфер с шагом global size. hist перед
+// запуском обнуляется.
+__kernel void iter_histogram(
+    __global const uint* iters,
+    const int count,
+    const int maxIter,
+    __global uint* hist)
+{
+    __local uint groupHist[HIST_LOCAL_BINS];
+    int lid = get_local_id(0);
+    int groupSize = get_local_size(0);
+    int bins = maxIter + 1;
+    bool useLocal = bins <= HIST_LOCAL_BINS;
+    if (useLocal)
+        for (int i = lid; i < bins; i += groupSize) groupHist[i] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int i = get_global_id(0); i < count; i += get_global_size(0)) {
+        uint iter = min(iters[i], (uint)maxIter);
+        if (useLocal) atomic_inc(&groupHist[iter]);
+        else atomic_inc(&hist[iter]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (useLocal)
+        for (int i = lid; i < bins; i += groupSize)
+            if (groupHist[i]) atomic_add(&hist[i], groupHist[i]);
+}
+
+// Одна группа (не больше HIST_SCAN_GROUP элементов): каждый элемент
+// суммирует свой кусок корзин, суммы кусков сканируются в локальной
+// памяти, затем элементы дописывают CDF своего куска. cdf[i] — доля
+// убежавших пикселей с iter <= i; корзина maxIter (внутренность) в CDF не
+// входит.
+__kernel void histogram_cdf(
+    __global const uint* hist,
+    const int maxIter,
+    __global float* cdf)
+{
+    __local uint sums[HIST_SCAN_GROUP];
+    int lid = get_local_id(0);
+    int n = get_local_size(0);
+    int chunk = (maxIter + n - 1) / n;
+    int begin = min(lid * chunk, maxIter);
+    int end = min(begin + chunk, maxIter);
+    uint sum = 0;
+    for (int i = begin; i < end; i++) sum += hist[i];
+    sums[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    // Включающее сканирование Хиллиса–Стила: log2(n) шагов
+    for (int offset = 1; offset < n; offset <<= 1) {
+        uint add = lid >= offset ? sums[lid - offset] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        sums[lid] += add;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    uint total = sums[n - 1];
+    float scale = total ? 1.0f / total : 0.0f;
+    uint running = sums[lid] - sum;
+    for (int i = begin; i < end; i++) {
+        running += hist[i];
+        cdf[i] = running * scale;
+    }
+}
+
+// Пиксель на элемент: цвет из PALETTE по CDF, как equalizedColor на CPU.
+// rgb — 3 байта на пиксель.
+__kernel void histogram_map(
+    __global const uint* iters,
+    const int count,
+    const int maxIter,
+    __global const float* cdf,
+    __global uchar* rgb)
+{
+    int i = get_global_id(0);
+    if (i >= count) return;
+    uint iter = iters[i];
+    uchar4 c = iter >= (uint)maxIter ? (uchar4)(0,0,0,255) : PALETTE[(int)(cdf[iter] * (PALETTE_SIZE - 1))];
+    rgb[3*i] = c.x;
+    rgb[3*i + 1] = c.y;
+    rgb[3*i + 2] = c.z;
+}
+)";
@@ -0,0 +1,39 @@
+#pragma once
+
+// Исходник OpenCL ядра. Поведение задаётся аргументами, но часть из них
+// можно зафиксировать на этапе компиляции через -D опции (см. kernel_cache.h):
+//   SPEC_MAX_ITER=n     — число итераций вместо аргумента maxIter
+//   SPEC_WIDTH/HEIGHT=n — размер кадра вместо аргументов width/height
+//   SPEC_COLOR_MODE=n   — палитра вместо аргумента colorMode
+//   SPEC_FLOAT          — итерации в float вместо double
+//   SPEC_EARLY_OUT      — проверка главной кардиоиды и круга периода 2
+//                         (только у Mandelbrot)
+//   SPEC_UNROLL=n       — развёртка цикла итераций (2, 4, 8, 16; см. autotune.h)
+//   SPEC_ITER_BLOCK=n   — проверка выхода раз в n итераций с откатом блока
+//   SPEC_STRICT_FP      — запрет fma, чтобы double совпадал с CPU бит в бит
+//   SPEC_STATS          — ядра считают WorkStats (последний аргумент stats,
+//                         число корзин гистограммы — STATS_BINS=n)
+//   SPEC_SMOOTH         — mandelbrot_iter пишет и дробное число итераций
+//                         (аргумент smooth после stats)
+//   SPEC_DISTANCE       — mandelbrot_iter считает и производную dz/dc и пишет
+//                         оценку расстояния до множества в пикселях
+//                         (аргумент distance последним)
+//   SPEC_INTERIOR       — остановка точек, притянутых к циклу, по производной
+//                         dz/dz (порог INTERIOR_EPS2=x); с SPEC_DISTANCE не
+//                         действует
+// SPEC_DISTANCE и SPEC_INTERIOR — только с Mandelbrot. Формулу итераций
+// задаёт не -D, а начало исходника (formulaKernelSource в formula.h):
+// buildMandelbrot добавляет его сам.
+// Ядра: mandelbrot (рабочий элемент на пиксель), mandelbrot_persistent
+// (постоянные потоки с общей очередью пикселей, лишний аргумент — счётчик)
+// и mandelbrot_iter (число итераций вместо цвета, для Engine);
+// mandelbrot_points считает произвольные точки (Engine::renderPoints). Ядра
+// iter_histogram, histogram_cdf и histogram_map раскрашивают готовый буфер
+// итераций выравниванием гистограммы (см. ClEngine::equalize).
+extern const char *mandelbrotKernel;
+
+// --- Палитры (аргумент colorMode) ---
+// COLOR_SMOOTH — дробное число итераций и циклическая таблица PALETTE,
+// которую программа получает в начале исходника (paletteKernelSource в
+// palette.h; buildMandelbrot добавляет её сам).
+enum ColorMode { COLOR_POLY = 0, COLOR_HSV = 1, COLOR_SMOOTH = 2, COLOR_MODE_COUNT };
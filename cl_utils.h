@@ -0,0 +1,36 @@
+#pragma once
+// clang-format off
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 200
+#endif
+#include <CL/cl.h>
+#include <string>
+// clang-format on
+
+// --- Лог сборки программы (для вывода ошибок компиляции ядра) ---
+inline std::string programBuildLog(cl_program program, cl_device_id device) {
+    size_t logSize = 0;
+    clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+    std::string log(logSize, '\0');
+    if (logSize) clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, logSize, &log[0], nullptr);
+    return log;
+}
+
+// --- Строковый параметр устройства (имя, версия драйвера и т.п.) ---
+inline std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    clGetDeviceInfo(device, param, 0, nullptr, &size);
+    std::string value(size, '\0');
+    if (size) clGetDeviceInfo(device, param, size, &value[0], nullptr);
+    while (!value.empty() && value.back() == '\0') value.pop_back();
+    return value;
+}
+
+// --- Длительность команды по событию (очередь с CL_QUEUE_PROFILING_ENABLE), мс ---
+inline double eventMs(cl_event event) {
+    cl_ulong start = 0, end = 0;
+    if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) != CL_SUCCESS ||
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) != CL_SUCCESS)
+        return 0.0;
+    return (end - start) * 1e-6;
+}
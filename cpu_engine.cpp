@@ -0,0 +1,331 @@
+#include "cpu_engine.h"
+#include "histogram_color.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace {
+
+// Главная кардиоида и круг периода 2 (как inMainBulbs в ядре)
+bool inMainBulbs(double real, double imag) {
+    double xq = real - 0.25;
+    double q = xq * xq + imag * imag;
+    if (q * (q + xq) <= 0.25 * imag * imag) return true;
+    double xb = real + 1.0;
+    return xb * xb + imag * imag <= 0.0625;
+}
+
+// --- Формулы итераций (formula.h) для шаблонов расчёта ---
+// init — начало орбиты из точки плоскости, step — один шаг z -> f(z) + c.
+// Шаг встраивается в цикл iterate при инстанцировании, выбор формулы —
+// раз на кадр (withFormula). Порядок операций — как у formulaKernelSource.
+struct MandelbrotStep {
+    static const bool MANDELBROT = true;
+    void init(double real, double imag, double &zr, double &zi, double &cr, double &ci) const {
+        zr = 0;
+        zi = 0;
+        cr = real;
+        ci = imag;
+    }
+    void step(double &zr, double &zi, double cr, double ci) const {
+        double tmp = zr * zr - zi * zi + cr;
+        zi = 2.0 * zr * zi + ci;
+        zr = tmp;
+    }
+};
+
+struct JuliaStep : MandelbrotStep {
+    static const bool MANDELBROT = false;
+    double juliaX, juliaY;
+    JuliaStep(double x, double y) : juliaX(x), juliaY(y) {}
+    void init(double real, double imag, double &zr, double &zi, double &cr, double &ci) const {
+        zr = real;
+        zi = imag;
+        cr = juliaX;
+        ci = juliaY;
+    }
+};
+
+template <int POWER>
+struct MultibrotStep : MandelbrotStep {
+    static const bool MANDELBROT = false;
+    void step(double &zr, double &zi, double cr, double ci) const {
+        double pr = zr, pi = zi, tmp;
+        for (int k = 2; k < POWER; k++) {
+            tmp = pr * zr - pi * zi;
+            pi = pr * zi + pi * zr;
+            pr = tmp;
+        }
+        tmp = pr * zr - pi * zi + cr;
+        zi = pr * zi + pi * zr + ci;
+        zr = tmp;
+    }
+};
+
+struct BurningShipStep : MandelbrotStep {
+    static const bool MANDELBROT = false;
+    void step(double &zr, double &zi, double cr, double ci) const {
+        double tmp = zr * zr - zi * zi + cr;
+        zi = std::fabs(2.0 * zr * zi) + ci;
+        zr = tmp;
+    }
+};
+
+// Вызов fn(шаг) с шагом нужной формулы: единственное ветвление по формуле
+template <class Fn>
+void withFormula(const Formula &formula, Fn &&fn) {
+    switch (formula.kind) {
+    case FORMULA_JULIA:
+        fn(JuliaStep(formula.juliaX, formula.juliaY));
+        break;
+    case FORMULA_MULTIBROT:
+        switch (formula.power) {
+        case 3: fn(MultibrotStep<3>()); break;
+        case 4: fn(MultibrotStep<4>()); break;
+        case 5: fn(MultibrotStep<5>()); break;
+        case 6: fn(MultibrotStep<6>()); break;
+        case 7: fn(MultibrotStep<7>()); break;
+        default: fn(MultibrotStep<MULTIBROT_MAX_POWER>()); break;
+        }
+        break;
+    case FORMULA_BURNING_SHIP:
+        fn(BurningShipStep());
+        break;
+    default:
+        fn(MandelbrotStep());
+    }
+}
+
+// norm — |z|^2 в момент выхода (для дробного числа итераций)
+template <class Step>
+uint32_t iterate(const Step &f, double real, double imag, int maxIter, double &norm) {
+    double zr, zi, cr, ci;
+    f.init(real, imag, zr, zi, cr, ci);
+    int iter = 0;
+    while (zr * zr + zi * zi < 4.0 && iter < maxIter) {
+        f.step(zr, zi, cr, ci);
+        iter++;
+    }
+    norm = zr * zr + zi * zi;
+    return iter;
+}
+
+// Как iterate в ядре с SPEC_INTERIOR: рядом с z идёт производная dz_n/dz_1
+// (произведение 2*z по орбите). У точки, притянутой к циклу, она убывает
+// геометрически, и как только |dz|^2 < INTERIOR_EPS2, счёт останавливается:
+// результат maxIter, как если бы точка дошла до предела. interiorAt —
+// итерация, на которой это случилось (0 — не случилось).
+const double INTERIOR_EPS2 = 1e-6;
+
+uint32_t iterateInterior(double real, double imag, int maxIter, double &norm, uint32_t &interiorAt) {
+    interiorAt = 0;
+    norm = 0;
+    if (maxIter <= 0) return 0;
+    // Первый шаг из z = 0 даёт z = c; производная отсчитывается от него
+    double zr = real, zi = imag, dzr = 1, dzi = 0;
+    int iter = 1;
+    while (zr * zr + zi * zi < 4.0 && iter < maxIter) {
+        double tmpD = 2.0 * (zr * dzr - zi * dzi);
+        dzi = 2.0 * (zr * dzi + zi * dzr);
+        dzr = tmpD;
+        double tmp = zr * zr - zi * zi + real;
+        zi = 2.0 * zr * zi + imag;
+        zr = tmp;
+        iter++;
+        if (dzr * dzr + dzi * dzi < INTERIOR_EPS2) {
+            interiorAt = iter;
+            return maxIter;
+        }
+    }
+    norm = zr * zr + zi * zi;
+    return iter;
+}
+
+// Как iterateDistance в ядре: оценка расстояния в единицах плоскости, 0 внутри
+const int DE_EXTRA_STEPS = 4;
+
+uint32_t iterateDistance(double real, double imag, int maxIter, double &norm, double &distance) {
+    double zr = 0, zi = 0, dzr = 0, dzi = 0;
+    int iter = 0;
+    distance = 0;
+    while (zr * zr + zi * zi < 4.0 && iter < maxIter) {
+        double tmpD = 2.0 * (zr * dzr - zi * dzi) + 1.0;
+        dzi = 2.0 * (zr * dzi + zi * dzr);
+        dzr = tmpD;
+        double tmp = zr * zr - zi * zi + real;
+        zi = 2.0 * zr * zi + imag;
+        zr = tmp;
+        iter++;
+    }
+    norm = zr * zr + zi * zi;
+    if (iter >= maxIter) return iter;
+    for (int k = 0; k < DE_EXTRA_STEPS && zr * zr + zi * zi < 1e8; k++) {
+        double tmpD = 2.0 * (zr * dzr - zi * dzi);
+        dzi = 2.0 * (zr * dzi + zi * dzr);
+        dzr = tmpD;
+        double tmp = zr * zr - zi * zi + real;
+        zi = 2.0 * zr * zi + imag;
+        zr = tmp;
+    }
+    double z2 = zr * zr + zi * zi;
+    distance = 0.25 * std::sqrt(z2 / (dzr * dzr + dzi * dzi)) * std::log(z2);
+    return iter;
+}
+
+// Как smoothIter в ядре; log2Power — formulaLog2Power
+float smoothIter(uint32_t iter, int maxIter, double norm, float log2Power) {
+    if ((int)iter >= maxIter) return (float)maxIter;
+    return iter + 1 - std::log2(std::log2((float)norm) * 0.5f) / log2Power;
+}
+
+// Ранний выход, distance и interior — только у Mandelbrot: у остальных
+// формул эти ветви выпадают при инстанцировании
+template <class Step>
+void renderTile(const Step &f, const View &view, IterationBuffer &out, int x0, int y0, bool interior,
+                float log2Power, WorkStats &stats) {
+    TRACE_SPAN("cpu tile");
+    double scale = view.zoom / (double)view.height;
+    int x1 = std::min(x0 + CpuEngine::TILE, view.width);
+    int y1 = std::min(y0 + CpuEngine::TILE, view.height);
+    for (int y = y0; y < y1; y++) {
+        double imag = view.centerY + (y - view.height / 2.0) * scale;
+        uint32_t *row = &out.iter[(size_t)y * view.width];
+        float *smooth = out.smooth.empty() ? nullptr : &out.smooth[(size_t)y * view.width];
+        float *distance = out.distance.empty() ? nullptr : &out.distance[(size_t)y * view.width];
+        for (int x = x0; x < x1; x++) {
+            double real = view.centerX + (x - view.width / 2.0) * scale;
+            bool skipped = Step::MANDELBROT && inMainBulbs(real, imag);
+            double norm = 0, de = 0;
+            uint32_t interiorAt = 0;
+            if (skipped) row[x] = view.maxIter;
+            else if (Step::MANDELBROT && distance) row[x] = iterateDistance(real, imag, view.maxIter, norm, de);
+            else if (Step::MANDELBROT && interior) row[x] = iterateInterior(real, imag, view.maxIter, norm, interiorAt);
+            else row[x] = iterate(f, real, imag, view.maxIter, norm);
+            if (smooth) smooth[x] = smoothIter(row[x], view.maxIter, norm, log2Power);
+            if (distance) distance[x] = (float)(de / scale);
+            stats.add(row[x], skipped, interiorAt);
+        }
+    }
+}
+
+}  // namespace
+
+CpuEngine::CpuEngine(int threads) : threads_(threads > 0 ? threads : (int)std::thread::hardware_concurrency()) {
+    if (threads_ <= 0) threads_ = 1;
+}
+
+CpuEngine::~CpuEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &thread : workers_) thread.join();
+}
+
+void CpuEngine::parallel(int participants, const std::function<void()> &work) {
+    int helpers = std::min(participants, threads_) - 1;
+    if (helpers <= 0) {
+        work();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while ((int)workers_.size() < threads_ - 1) workers_.emplace_back(&CpuEngine::worker, this);
+        job_ = &work;
+        jobSlots_ = helpers;
+        jobRunning_ = helpers;
+    }
+    wake_.notify_all();
+    work();
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return jobRunning_ == 0; });
+    job_ = nullptr;
+}
+
+void CpuEngine::worker() {
+    traceSetThreadName("cpu worker");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || jobSlots_ > 0; });
+        if (stopping_) return;
+        jobSlots_--;
+        const std::function<void()> &job = *job_;
+        lock.unlock();
+        job();
+        lock.lock();
+        if (--jobRunning_ == 0) done_.notify_all();
+    }
+}
+
+std::string CpuEngine::name() const {
+    return "cpu";
+}
+
+bool CpuEngine::render(const View &view, IterationBuffer &out) {
+    // Производную считает только Mandelbrot
+    out.resize(view.width, view.height, smooth_, distance_ && formula_.kind == FORMULA_MANDELBROT);
+    int tilesX = (view.width + TILE - 1) / TILE;
+    int tilesY = (view.height + TILE - 1) / TILE;
+    int tiles = tilesX * tilesY;
+
+    // Плитки разбираются потоками через общий счётчик: дорогие плитки
+    // (внутренность множества) не задерживают остальные
+    // Статистику каждый поток копит у себя и сливает в конце
+    std::atomic<int> next{0};
+    std::mutex statsMutex;
+    stats_.reset(view.maxIter);
+    float log2Power = formulaLog2Power(formula_);
+    auto work = [&] {
+        WorkStats local;
+        local.reset(view.maxIter);
+        withFormula(formula_, [&](const auto &f) {
+            for (int tile = next++; tile < tiles; tile = next++)
+                renderTile(f, view, out, (tile % tilesX) * TILE, (tile / tilesX) * TILE, interior_, log2Power, local);
+        });
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats_.merge(local);
+    };
+    parallel(tiles, work);
+    return true;
+}
+
+bool CpuEngine::renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                             std::vector<float> &smooth) {
+    TRACE_SPAN("cpu points");
+    size_t count = points.size() / 2;
+    iter.resize(count);
+    smooth.resize(count);
+    // Пачками через общий счётчик, как плитки в render
+    const size_t BATCH = 256;
+    std::atomic<size_t> next{0};
+    float log2Power = formulaLog2Power(formula_);
+    auto work = [&] {
+        withFormula(formula_, [&](const auto &f) {
+            using Step = std::decay_t<decltype(f)>;
+            for (size_t begin = next.fetch_add(BATCH); begin < count; begin = next.fetch_add(BATCH)) {
+                for (size_t i = begin; i < std::min(begin + BATCH, count); i++) {
+                    double real = points[2 * i], imag = points[2 * i + 1];
+                    double norm = 0;
+                    uint32_t interiorAt;
+                    if (Step::MANDELBROT && inMainBulbs(real, imag)) iter[i] = view.maxIter;
+                    else if (Step::MANDELBROT && interior_)
+                        iter[i] = iterateInterior(real, imag, view.maxIter, norm, interiorAt);
+                    else iter[i] = iterate(f, real, imag, view.maxIter, norm);
+                    smooth[i] = smoothIter(iter[i], view.maxIter, norm, log2Power);
+                }
+            }
+        });
+    };
+    parallel((int)std::min<size_t>((count + BATCH - 1) / BATCH, threads_), work);
+    return true;
+}
+
+bool CpuEngine::equalize(const IterationBuffer &in, int maxIter, std::vector<uint8_t> &rgb) {
+    equalizeHistogram(in, maxIter, threads_, rgb, equalizeStats_);
+    return true;
+}
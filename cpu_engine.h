@@ -0,0 +1,46 @@
+#pragma once
+#include "engine.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --- Расчёт на CPU: double, плитки по потокам ---
+// Формулы и порядок операций те же, что в ядре OpenCL, поэтому результат
+// совпадает с cl-double бит в бит (служит эталоном для тестов).
+// Рабочие потоки заводятся при первом расчёте и живут вместе с
+// вычислителем: кадр за кадром их не создают заново.
+class CpuEngine : public Engine {
+public:
+    static const int TILE = 64;
+
+    // threads == 0 — по числу аппаратных потоков
+    explicit CpuEngine(int threads = 0);
+    ~CpuEngine() override;
+    CpuEngine(const CpuEngine &) = delete;
+    CpuEngine &operator=(const CpuEngine &) = delete;
+
+    std::string name() const override;
+    Precision precision() const override { return PRECISION_DOUBLE; }
+    bool render(const View &view, IterationBuffer &out) override;
+    bool renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                      std::vector<float> &smooth) override;
+    bool equalize(const IterationBuffer &in, int maxIter, std::vector<uint8_t> &rgb) override;
+
+private:
+    // work на participants потоках (не больше threads_, включая вызывающий);
+    // возвращается, когда все закончили
+    void parallel(int participants, const std::function<void()> &work);
+    void worker();
+
+    int threads_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void()> *job_ = nullptr;
+    int jobSlots_ = 0;    // сколько рабочих ещё могут взять job_
+    int jobRunning_ = 0;  // сколько рабочих ещё не закончили job_
+    bool stopping_ = false;
+};
@@ -0,0 +1,29 @@
+#include "engine.h"
+#include "cl_engine.h"
+#include "cpu_engine.h"
+#include "histogram_color.h"
+#include <iostream>
+
+bool Engine::equalize(const IterationBuffer &in, int maxIter, std::vector<uint8_t> &rgb) {
+    equalizeHistogram(in, maxIter, 0, rgb, equalizeStats_);
+    return true;
+}
+
+std::vector<std::unique_ptr<Engine>> createEngines() {
+    std::vector<std::unique_ptr<Engine>> engines;
+    for (cl_device_id device : allClDevices()) {
+        // Ядро требует fp64 даже в режиме float (координаты приходят в double)
+        cl_ulong fp64 = 0;
+        clGetDeviceInfo(device, CL_DEVICE_DOUBLE_FP_CONFIG, sizeof(fp64), &fp64, nullptr);
+        if (!fp64) {
+            std::cerr << "skipping " << deviceString(device, CL_DEVICE_NAME) << ": no fp64 support" << std::endl;
+            continue;
+        }
+        for (bool useFloat : {false, true}) {
+            auto engine = std::make_unique<ClEngine>(device, useFloat);
+            if (engine->ready()) engines.push_back(std::move(engine));
+        }
+    }
+    engines.push_back(std::make_unique<CpuEngine>());
+    return engines;
+}
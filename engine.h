@@ -0,0 +1,103 @@
+#pragma once
+#include "formula.h"
+#include "view.h"
+#include "work_stats.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --- Результат расчёта: число итераций для каждого пикселя ---
+// Строки идут снизу вверх, как и y в View (и как в текстуре OpenGL).
+// smooth — дробное число итераций iter + 1 - log2(log2|z|) в точке выхода
+// (maxIter внутри множества); distance — оценка расстояния до множества в
+// пикселях по производной dz/dc (0 внутри). Пусты, если вычислитель их не
+// считал.
+struct IterationBuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> iter;
+    std::vector<float> smooth;
+    std::vector<float> distance;
+
+    void resize(int w, int h, bool withSmooth = false, bool withDistance = false) {
+        width = w;
+        height = h;
+        iter.resize((size_t)w * h);
+        smooth.resize(withSmooth ? (size_t)w * h : 0);
+        distance.resize(withDistance ? (size_t)w * h : 0);
+    }
+};
+
+// --- Время раскраски выравниванием гистограммы по проходам (мс) ---
+struct EqualizeStats {
+    double histogramMs = 0;  // гистограммы и их слияние
+    double cdfMs = 0;        // префиксная сумма в CDF
+    double mapMs = 0;        // раскраска по CDF
+    double uploadMs = 0;     // копирование итераций на устройство (OpenCL)
+    double readbackMs = 0;   // чтение цветов с устройства (OpenCL)
+
+    double totalMs() const { return histogramMs + cdfMs + mapMs + uploadMs + readbackMs; }
+};
+
+// --- Точность, в которой считает вычислитель ---
+enum Precision { PRECISION_DOUBLE, PRECISION_FLOAT };
+
+// --- Вычислитель: OpenCL устройство, CPU и т.п. ---
+class Engine {
+public:
+    virtual ~Engine() = default;
+
+    // Имя для отчётов, например "cpu" или "cl-double NVIDIA GeForce ..."
+    virtual std::string name() const = 0;
+    virtual Precision precision() const = 0;
+
+    // Посчитать вид целиком; false при ошибке
+    virtual bool render(const View &view, IterationBuffer &out) = 0;
+
+    // Отдельные точки плоскости: points — пары (re, im); на выходе число
+    // итераций и дробное число итераций каждой (предел — view.maxIter,
+    // точность — как у render того же вида). stats() не меняется.
+    virtual bool renderPoints(const View &view, const std::vector<double> &points, std::vector<uint32_t> &iter,
+                              std::vector<float> &smooth) = 0;
+
+    // Статистика последнего успешного render()
+    const WorkStats &stats() const { return stats_; }
+
+    // Раскраска выравниванием гистограммы (histogram_color.h) кадра in,
+    // посчитанного с пределом maxIter: rgb — 3 байта на пиксель, строки в
+    // порядке in. По умолчанию — на CPU; false при ошибке.
+    virtual bool equalize(const IterationBuffer &in, int maxIter, std::vector<uint8_t> &rgb);
+    // Время проходов последнего equalize()
+    const EqualizeStats &equalizeStats() const { return equalizeStats_; }
+
+    // Считать ли IterationBuffer::smooth. Вычислители, которые не умеют,
+    // оставляют его пустым.
+    void setSmooth(bool enabled) { smooth_ = enabled; }
+    bool smooth() const { return smooth_; }
+    // Считать ли IterationBuffer::distance: производная идёт рядом с z на
+    // каждой итерации, так что расчёт дороже (см. bench --distance)
+    void setDistance(bool enabled) { distance_ = enabled; }
+    bool distance() const { return distance_; }
+    // Останавливать точки, притянутые к циклу, по производной dz/dz
+    // (render и renderPoints): внутренность множества вне кардиоиды и
+    // круга периода 2 не досчитывается до maxIter. С setDistance не
+    // действует. Сколько пикселей поймано — WorkStats::interior.
+    void setInteriorCheck(bool enabled) { interior_ = enabled; }
+    // Формула итераций (formula.h) для render и renderPoints; по умолчанию
+    // Mandelbrot. У других формул setDistance и setInteriorCheck не
+    // действуют (IterationBuffer::distance пуст).
+    void setFormula(const Formula &formula) { formula_ = formula; }
+    const Formula &formula() const { return formula_; }
+
+protected:
+    WorkStats stats_;
+    EqualizeStats equalizeStats_;
+    bool smooth_ = false;
+    bool distance_ = false;
+    bool interior_ = false;
+    Formula formula_;
+};
+
+// Все доступные вычислители: каждое OpenCL устройство в двух точностях и CPU
+std::vector<std::unique_ptr<Engine>> createEngines();
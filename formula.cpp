@@ -0,0 +1,109 @@
+#include "formula.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool parseFormula(const char *text, Formula &formula) {
+    Formula parsed;
+    if (std::strcmp(text, "mandelbrot") == 0) {
+        parsed.kind = FORMULA_MANDELBROT;
+    } else if (std::strcmp(text, "burning-ship") == 0) {
+        parsed.kind = FORMULA_BURNING_SHIP;
+    } else if (std::strncmp(text, "julia:", 6) == 0) {
+        parsed.kind = FORMULA_JULIA;
+        if (std::sscanf(text + 6, "%lf,%lf", &parsed.juliaX, &parsed.juliaY) != 2) return false;
+    } else if (std::strncmp(text, "multibrot:", 10) == 0) {
+        if (std::sscanf(text + 10, "%d", &parsed.power) != 1) return false;
+        if (parsed.power != 2 && (parsed.power < MULTIBROT_MIN_POWER || parsed.power > MULTIBROT_MAX_POWER))
+            return false;
+        parsed.kind = parsed.power == 2 ? FORMULA_MANDELBROT : FORMULA_MULTIBROT;
+    } else {
+        return false;
+    }
+    formula = parsed;
+    return true;
+}
+
+namespace {
+
+// Кратчайшая из %.15g и %.17g, которая читается обратно в то же число
+std::string shortestString(double x) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.15g", x);
+    if (std::strtod(text, nullptr) != x) std::snprintf(text, sizeof(text), "%.17g", x);
+    return text;
+}
+
+}  // namespace
+
+std::string formulaName(const Formula &formula) {
+    switch (formula.kind) {
+    case FORMULA_JULIA:
+        return "julia:" + shortestString(formula.juliaX) + "," + shortestString(formula.juliaY);
+    case FORMULA_MULTIBROT:
+        return "multibrot:" + std::to_string(formula.power);
+    case FORMULA_BURNING_SHIP:
+        return "burning-ship";
+    default:
+        return "mandelbrot";
+    }
+}
+
+float formulaLog2Power(const Formula &formula) {
+    return formula.kind == FORMULA_MULTIBROT ? std::log2((float)formula.power) : 1.0f;
+}
+
+uint64_t formulaKey(const Formula &formula) {
+    if (formula.kind == FORMULA_MANDELBROT) return 0;
+    // FNV-1a по параметрам
+    uint64_t words[4] = {(uint64_t)formula.kind, (uint64_t)formula.power, 0, 0};
+    std::memcpy(&words[2], &formula.juliaX, sizeof(double));
+    std::memcpy(&words[3], &formula.juliaY, sizeof(double));
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t word : words)
+        for (int i = 0; i < 8; i++) {
+            hash ^= (word >> (8 * i)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    return hash ? hash : 1;
+}
+
+std::string formulaKernelSource(const Formula &formula) {
+    if (formula.kind == FORMULA_MANDELBROT) return "";
+    // Порядок операций — как в шаблонах cpu_engine.cpp: с SPEC_STRICT_FP
+    // результат совпадает с CPU бит в бит
+    char text[256];
+    std::string source = "#define FORMULA " + std::to_string((int)formula.kind) + "\n";
+    std::snprintf(text, sizeof(text), "#define FORMULA_LOG2_POWER ((float)%.17g)\n",
+                  (double)formulaLog2Power(formula));
+    source += text;
+    switch (formula.kind) {
+    case FORMULA_JULIA:
+        std::snprintf(text, sizeof(text),
+                      "#define FORMULA_INIT(real, imag) { zr = real; zi = imag; cr = (real_t)(%.17g); "
+                      "ci = (real_t)(%.17g); }\n",
+                      formula.juliaX, formula.juliaY);
+        source += text;
+        source += "#define FORMULA_STEP { real_t tmp = zr*zr - zi*zi + cr; zi = (real_t)2.0*zr*zi + ci; "
+                  "zr = tmp; }\n";
+        break;
+    case FORMULA_MULTIBROT:
+        // z^power развёрнуто: power - 2 умножения на z в p, затем p*z + c.
+        // Без запятых: шаг идёт аргументом макроса REPEAT (SPEC_UNROLL)
+        source += "#define FORMULA_INIT(real, imag) { zr = 0; zi = 0; cr = real; ci = imag; }\n";
+        source += "#define FORMULA_STEP { \\\n    real_t pr = zr; real_t pi = zi; real_t tmp; \\\n";
+        for (int k = 2; k < formula.power; k++)
+            source += "    tmp = pr*zr - pi*zi; pi = pr*zi + pi*zr; pr = tmp; \\\n";
+        source += "    tmp = pr*zr - pi*zi + cr; zi = pr*zi + pi*zr + ci; zr = tmp; }\n";
+        break;
+    case FORMULA_BURNING_SHIP:
+        source += "#define FORMULA_INIT(real, imag) { zr = 0; zi = 0; cr = real; ci = imag; }\n";
+        source += "#define FORMULA_STEP { real_t tmp = zr*zr - zi*zi + cr; zi = fabs((real_t)2.0*zr*zi) + ci; "
+                  "zr = tmp; }\n";
+        break;
+    default:
+        break;
+    }
+    return source;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// --- Формула итераций ---
+// z -> f(z) + c до выхода за |z| > 2:
+//   Mandelbrot    z^2 + c, z_0 = 0, c — точка плоскости
+//   Julia         z^2 + c, z_0 — точка плоскости, c постоянное (juliaX, juliaY)
+//   Multibrot     z^power + c, z_0 = 0 (power от MULTIBROT_MIN_POWER до MULTIBROT_MAX_POWER)
+//   Burning Ship  (|Re z| + i|Im z|)^2 + c, z_0 = 0
+// Формула выбирается раз на кадр: CPU (cpu_engine.cpp) инстанцирует расчёт
+// под каждую, OpenCL собирает программу с её шагом (formulaKernelSource),
+// так что во внутреннем цикле ветвлений по формуле нет. Ранний выход по
+// кардиоиде, оценка расстояния и проверка внутренности — только у Mandelbrot.
+enum FormulaKind { FORMULA_MANDELBROT, FORMULA_JULIA, FORMULA_MULTIBROT, FORMULA_BURNING_SHIP };
+
+const int MULTIBROT_MIN_POWER = 3;
+const int MULTIBROT_MAX_POWER = 8;
+
+struct Formula {
+    FormulaKind kind = FORMULA_MANDELBROT;
+    int power = 2;      // степень z (у всех, кроме Multibrot, 2)
+    double juliaX = 0;  // c множества Жюлиа
+    double juliaY = 0;
+
+    bool operator==(const Formula &other) const {
+        return kind == other.kind && power == other.power && juliaX == other.juliaX && juliaY == other.juliaY;
+    }
+    bool operator!=(const Formula &other) const { return !(*this == other); }
+};
+
+// "mandelbrot", "julia:X,Y", "multibrot:N" или "burning-ship" (multibrot:2 —
+// это mandelbrot); false, если не разобрано
+bool parseFormula(const char *text, Formula &formula);
+// Обратно в ту же запись (для отчётов)
+std::string formulaName(const Formula &formula);
+
+// log2(power) во float: делитель в дробном числе итераций
+// iter + 1 - log_power(log2|z|); одинаков у CPU и ядра
+float formulaLog2Power(const Formula &formula);
+
+// Ключ кэша плиток: 0 у Mandelbrot, у остальных — хэш параметров
+uint64_t formulaKey(const Formula &formula);
+
+// Начало исходника OpenCL перед mandelbrotKernel: FORMULA, начало орбиты
+// FORMULA_INIT и шаг FORMULA_STEP (см. cl_kernel.cpp). У Mandelbrot пусто —
+// ядро без этих определений считает его само.
+std::string formulaKernelSource(const Formula &formula);
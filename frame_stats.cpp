@@ -0,0 +1,54 @@
+#include "frame_stats.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const char *STAGE_NAMES[STAGE_COUNT] = {"kernel", "read", "upload", "swap", "frame"};
+
+}  // namespace
+
+RollingStats::RollingStats(size_t window) : window_(window) {
+    samples_.reserve(window);
+}
+
+void RollingStats::add(double value) {
+    if (samples_.size() < window_) {
+        samples_.push_back(value);
+    } else {
+        samples_[next_] = value;
+        next_ = (next_ + 1) % window_;
+    }
+}
+
+double RollingStats::percentile(double p) const {
+    if (samples_.empty()) return 0.0;
+    std::vector<double> sorted = samples_;
+    size_t k = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5));
+    std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    return sorted[k];
+}
+
+std::string FrameTimings::summary() const {
+    std::string text;
+    char part[64];
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const RollingStats &s = stages_[i];
+        std::snprintf(part, sizeof(part), "%s%s %.1f/%.1f/%.1f", i ? " | " : "", STAGE_NAMES[i], s.percentile(0.5),
+                      s.percentile(0.95), s.percentile(0.99));
+        text += part;
+    }
+    return text + " ms (p50/p95/p99)";
+}
+
+std::string FrameTimings::table() const {
+    std::string text = "stage        p50      p95      p99   (ms)\n";
+    char line[96];
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const RollingStats &s = stages_[i];
+        std::snprintf(line, sizeof(line), "%-8s %8.2f %8.2f %8.2f\n", STAGE_NAMES[i], s.percentile(0.5),
+                      s.percentile(0.95), s.percentile(0.99));
+        text += line;
+    }
+    return text;
+}
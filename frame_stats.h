@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// --- Скользящее окно последних замеров с перцентилями ---
+class RollingStats {
+public:
+    explicit RollingStats(size_t window = 240);
+
+    void add(double value);
+    // p в [0, 1]; 0, если замеров ещё нет
+    double percentile(double p) const;
+    size_t count() const { return samples_.size(); }
+
+private:
+    size_t window_;
+    size_t next_ = 0;
+    std::vector<double> samples_;
+};
+
+// --- Этапы кадра ---
+enum FrameStage { STAGE_KERNEL, STAGE_READBACK, STAGE_UPLOAD, STAGE_SWAP, STAGE_FRAME, STAGE_COUNT };
+
+// --- Время этапов кадра (мс) ---
+class FrameTimings {
+public:
+    void record(FrameStage stage, double ms) { stages_[stage].add(ms); }
+    const RollingStats &stage(FrameStage stage) const { return stages_[stage]; }
+
+    // Короткая строка для заголовка окна: p50/p95/p99 по каждому этапу
+    std::string summary() const;
+    // Подробная таблица для консоли
+    std::string table() const;
+
+private:
+    RollingStats stages_[STAGE_COUNT];
+};
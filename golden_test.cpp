@@ -0,0 +1,345 @@
+// --- Сверка всех вычислителей с эталонными буферами итераций ---
+// Использование: golden_test [--dir goldens] [--engine подстрока]
+//                            [--formula подстрока] [--float-tolerance доля]
+//                            [--smooth-tolerance d] [--distance-tolerance доля]
+//                            [--interior] [--update]
+// Эталоны считает CPU (double) и хранит в goldens/<вид>.iter, дробные
+// итерации — в <вид>.smooth, оценку расстояния — в <вид>.distance; --update
+// пересчитывает их. Каждый вид проверяется в нескольких проходах: обычном,
+// с дробными итерациями (setSmooth) и с оценкой расстояния (setDistance) —
+// у OpenCL это разные варианты ядра. Итерации в каждом проходе вычислители
+// той же точности обязаны совпасть бит в бит, float — не более чем в
+// заданной доле пикселей (и только там, где шаг пикселя крупнее
+// FLOAT_SCALE_LIMIT; глубже float не различает точки). Плоскости smooth и
+// distance сверяются там, где совпали итерации: smooth — с абсолютным
+// допуском (в итерациях), distance — с относительным; логарифмы у
+// устройств и CPU могут расходиться в последних битах float.
+// --interior добавляет проход с проверкой внутренности (setInteriorCheck):
+// пойманные точки получают maxIter, так что итерации обязаны совпасть с
+// тем же эталоном <вид>.iter — ложное срабатывание у границы множества
+// видно как отличие.
+// Второе измерение — формула: Mandelbrot на эталонных видах (views.h),
+// Julia, Multibrot и Burning Ship на своих видах (GOLDEN_FORMULAS), файлы
+// <формула>-<вид>.*. У OpenCL это отдельные программы (formulaKernelSource),
+// так что double обязан совпасть с CPU бит в бит и здесь. Оценка расстояния
+// и проверка внутренности есть только у Mandelbrot — у остальных формул
+// эти проходы пропускаются. --formula оставляет формулы, в записи которых
+// (formulaName) есть подстрока.
+#include "cpu_engine.h"
+#include "engine.h"
+#include "formula.h"
+#include "views.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int GOLDEN_WIDTH = 128;
+const int GOLDEN_HEIGHT = 96;
+const char GOLDEN_MAGIC[4] = {'M', 'G', 'L', 'D'};
+const char PLANE_MAGIC[4] = {'M', 'G', 'L', 'F'};
+
+// --- Эталоны других формул ---
+struct FormulaView {
+    const char *name;
+    const char *formula;  // как в --formula инструментов
+    double centerX, centerY, zoom;
+    int maxIter;
+};
+
+const FormulaView GOLDEN_FORMULAS[] = {
+    {"julia-full", "julia:-0.8,0.156", 0.0, 0.0, 3.0, 500},
+    {"julia-spiral", "julia:-0.8,0.156", 0.25, 0.05, 0.25, 1000},
+    {"multibrot3-full", "multibrot:3", 0.0, 0.0, 3.0, 500},
+    {"multibrot5-full", "multibrot:5", 0.0, 0.0, 3.0, 500},
+    {"burning-ship-full", "burning-ship", -0.5, -0.5, 3.0, 500},
+    {"burning-ship-detail", "burning-ship", -1.755, -0.03, 0.08, 1000},
+};
+
+// Что сверяется: вид в размере эталона и формула
+struct GoldenCase {
+    std::string name;  // имя файлов эталона без расширения
+    View view;
+    Formula formula;
+};
+
+// --- Проходы сверки ---
+enum Pass { PASS_PLAIN, PASS_SMOOTH, PASS_DISTANCE, PASS_INTERIOR };
+const char *const PASS_NAMES[] = {"plain", "smooth", "distance", "interior"};
+
+struct Options {
+    std::string dir = "goldens";
+    std::string engineFilter;
+    std::string formulaFilter;
+    double floatTolerance = 0.02;     // доля отличающихся пикселей для float
+    double smoothTolerance = 0.01;    // |d| дробных итераций
+    double distanceTolerance = 1e-3;  // |d| / |эталон| оценки расстояния
+    bool interior = false;  // проход с setInteriorCheck
+    bool update = false;
+};
+
+// Формат: "MGLD", uint32 width, height, maxIter, затем width*height uint32
+bool readGolden(const std::string &path, IterationBuffer &buffer, int &maxIter) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t header[3];
+    if (!in.read(magic, 4) || std::memcmp(magic, GOLDEN_MAGIC, 4) != 0) return false;
+    if (!in.read((char *)header, sizeof(header))) return false;
+    buffer.resize(header[0], header[1]);
+    maxIter = header[2];
+    return (bool)in.read((char *)buffer.iter.data(), buffer.iter.size() * sizeof(uint32_t));
+}
+
+bool writeGolden(const std::string &path, const IterationBuffer &buffer, int maxIter) {
+    std::ofstream out(path, std::ios::binary);
+    uint32_t header[3] = {(uint32_t)buffer.width, (uint32_t)buffer.height, (uint32_t)maxIter};
+    out.write(GOLDEN_MAGIC, 4);
+    out.write((const char *)header, sizeof(header));
+    out.write((const char *)buffer.iter.data(), buffer.iter.size() * sizeof(uint32_t));
+    return (bool)out;
+}
+
+// Плоскость float: "MGLF", uint32 width, height, maxIter, затем width*height float
+bool readPlane(const std::string &path, int width, int height, int maxIter, std::vector<float> &plane) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t header[3];
+    if (!in.read(magic, 4) || std::memcmp(magic, PLANE_MAGIC, 4) != 0) return false;
+    if (!in.read((char *)header, sizeof(header))) return false;
+    if ((int)header[0] != width || (int)header[1] != height || (int)header[2] != maxIter) return false;
+    plane.resize((size_t)width * height);
+    return (bool)in.read((char *)plane.data(), plane.size() * sizeof(float));
+}
+
+bool writePlane(const std::string &path, int width, int height, int maxIter, const std::vector<float> &plane) {
+    std::ofstream out(path, std::ios::binary);
+    uint32_t header[3] = {(uint32_t)width, (uint32_t)height, (uint32_t)maxIter};
+    out.write(PLANE_MAGIC, 4);
+    out.write((const char *)header, sizeof(header));
+    out.write((const char *)plane.data(), plane.size() * sizeof(float));
+    return (bool)out;
+}
+
+struct DiffStats {
+    size_t differing = 0;  // пикселей с другими итерациями
+    uint32_t maxAbs = 0;
+    double meanAbs = 0;        // по отличающимся пикселям
+    size_t planeDiffering = 0;  // из совпавших по итерациям — вне допуска плоскости
+    double planeMax = 0;        // наибольшее отклонение плоскости (в единицах допуска)
+};
+
+DiffStats compare(const IterationBuffer &a, const IterationBuffer &b) {
+    DiffStats stats;
+    double sum = 0;
+    for (size_t i = 0; i < a.iter.size(); i++) {
+        uint32_t diff = a.iter[i] > b.iter[i] ? a.iter[i] - b.iter[i] : b.iter[i] - a.iter[i];
+        if (!diff) continue;
+        stats.differing++;
+        stats.maxAbs = std::max(stats.maxAbs, diff);
+        sum += diff;
+    }
+    if (stats.differing) stats.meanAbs = sum / stats.differing;
+    return stats;
+}
+
+// Плоскость b против эталона a там, где итерации совпали; relative —
+// допуск в долях эталона, иначе абсолютный
+void comparePlane(const IterationBuffer &golden, const std::vector<float> &a, const IterationBuffer &buffer,
+                  const std::vector<float> &b, double tolerance, bool relative, DiffStats &stats) {
+    for (size_t i = 0; i < a.size(); i++) {
+        if (golden.iter[i] != buffer.iter[i] || a[i] == b[i] || (std::isnan(a[i]) && std::isnan(b[i]))) continue;
+        double scale = relative ? std::max(std::fabs((double)a[i]), std::fabs((double)b[i])) : 1.0;
+        // NaN или бесконечность только с одной стороны — заведомо вне допуска
+        double error = std::isfinite(a[i]) && std::isfinite(b[i]) ? std::fabs((double)a[i] - b[i]) / scale
+                                                                  : HUGE_VAL;
+        stats.planeMax = std::max(stats.planeMax, error / tolerance);
+        if (error > tolerance) stats.planeDiffering++;
+    }
+}
+
+// Mandelbrot на эталонных видах, затем GOLDEN_FORMULAS; только формулы,
+// в записи которых есть filter
+std::vector<GoldenCase> goldenCases(const std::string &filter) {
+    std::vector<GoldenCase> cases;
+    for (const NamedView &named : canonicalViews()) {
+        GoldenCase golden;
+        golden.name = named.name;
+        golden.view = named.view;
+        cases.push_back(golden);
+    }
+    for (const FormulaView &entry : GOLDEN_FORMULAS) {
+        GoldenCase golden;
+        golden.name = entry.name;
+        golden.view.centerX = entry.centerX;
+        golden.view.centerY = entry.centerY;
+        golden.view.zoom = entry.zoom;
+        golden.view.maxIter = entry.maxIter;
+        parseFormula(entry.formula, golden.formula);
+        cases.push_back(golden);
+    }
+    std::vector<GoldenCase> selected;
+    for (GoldenCase &golden : cases) {
+        golden.view.width = GOLDEN_WIDTH;
+        golden.view.height = GOLDEN_HEIGHT;
+        if (formulaName(golden.formula).find(filter) != std::string::npos) selected.push_back(golden);
+    }
+    return selected;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(arg, "--update") == 0) {
+            options.update = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--interior") == 0) {
+            options.interior = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--dir") == 0 && value) {
+            options.dir = value;
+        } else if (std::strcmp(arg, "--engine") == 0 && value) {
+            options.engineFilter = value;
+        } else if (std::strcmp(arg, "--formula") == 0 && value) {
+            options.formulaFilter = value;
+        } else if (std::strcmp(arg, "--float-tolerance") == 0 && value) {
+            options.floatTolerance = std::atof(value);
+        } else if (std::strcmp(arg, "--smooth-tolerance") == 0 && value) {
+            options.smoothTolerance = std::atof(value);
+        } else if (std::strcmp(arg, "--distance-tolerance") == 0 && value) {
+            options.distanceTolerance = std::atof(value);
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: golden_test [--dir goldens] [--engine substr] [--formula substr]"
+                     " [--float-tolerance fraction] [--smooth-tolerance d] [--distance-tolerance fraction]"
+                     " [--interior] [--update]"
+                  << std::endl;
+        return 2;
+    }
+
+    std::vector<GoldenCase> cases = goldenCases(options.formulaFilter);
+    if (options.update) {
+        // Итерации не зависят от setSmooth и setDistance: все эталоны вида
+        // из одного расчёта
+        CpuEngine reference;
+        reference.setSmooth(true);
+        reference.setDistance(true);
+        IterationBuffer buffer;
+        for (const GoldenCase &golden : cases) {
+            const View &view = golden.view;
+            bool mandelbrot = golden.formula.kind == FORMULA_MANDELBROT;
+            std::string base = options.dir + "/" + golden.name;
+            reference.setFormula(golden.formula);
+            if (!reference.render(view, buffer) || !writeGolden(base + ".iter", buffer, view.maxIter) ||
+                !writePlane(base + ".smooth", view.width, view.height, view.maxIter, buffer.smooth) ||
+                (mandelbrot &&
+                 !writePlane(base + ".distance", view.width, view.height, view.maxIter, buffer.distance))) {
+                std::cerr << "cannot write " << base << ".*" << std::endl;
+                return 1;
+            }
+            std::cout << "updated " << base << (mandelbrot ? ".iter, .smooth, .distance" : ".iter, .smooth")
+                      << std::endl;
+        }
+        return 0;
+    }
+
+    int failures = 0, checks = 0;
+    IterationBuffer golden, buffer;
+    std::vector<float> goldenSmooth, goldenDistance;
+    for (auto &engine : createEngines()) {
+        std::string engineName = engine->name();
+        if (engineName.find(options.engineFilter) == std::string::npos) continue;
+
+        for (const GoldenCase &goldenCase : cases) {
+            const View &view = goldenCase.view;
+            const char *name = goldenCase.name.c_str();
+            bool mandelbrot = goldenCase.formula.kind == FORMULA_MANDELBROT;
+            std::string base = options.dir + "/" + goldenCase.name;
+            int goldenMaxIter = 0;
+            if (!readGolden(base + ".iter", golden, goldenMaxIter) || golden.width != view.width ||
+                golden.height != view.height || goldenMaxIter != view.maxIter ||
+                !readPlane(base + ".smooth", view.width, view.height, view.maxIter, goldenSmooth) ||
+                (mandelbrot &&
+                 !readPlane(base + ".distance", view.width, view.height, view.maxIter, goldenDistance))) {
+                std::cerr << "missing or stale golden " << base << ".* (run with --update)" << std::endl;
+                return 1;
+            }
+
+            bool exact = engine->precision() == PRECISION_DOUBLE;
+            if (!exact && view.zoom / view.height < FLOAT_SCALE_LIMIT) {
+                std::printf("%-40s %-20s skipped (beyond float precision)\n", engineName.c_str(), name);
+                continue;
+            }
+
+            engine->setFormula(goldenCase.formula);
+            for (Pass pass : {PASS_PLAIN, PASS_SMOOTH, PASS_DISTANCE, PASS_INTERIOR}) {
+                if (pass == PASS_INTERIOR && !options.interior) continue;
+                if ((pass == PASS_DISTANCE || pass == PASS_INTERIOR) && !mandelbrot) continue;
+                engine->setSmooth(pass == PASS_SMOOTH);
+                engine->setDistance(pass == PASS_DISTANCE);
+                engine->setInteriorCheck(pass == PASS_INTERIOR);
+                checks++;
+                bool rendered = engine->render(view, buffer);
+                engine->setSmooth(false);
+                engine->setDistance(false);
+                engine->setInteriorCheck(false);
+                if (!rendered) {
+                    std::printf("%-40s %-20s %-8s FAIL: render failed\n", engineName.c_str(), name,
+                                PASS_NAMES[pass]);
+                    failures++;
+                    continue;
+                }
+                const std::vector<float> &plane = pass == PASS_SMOOTH ? buffer.smooth : buffer.distance;
+                bool withPlane = pass == PASS_SMOOTH || pass == PASS_DISTANCE;
+                if (withPlane && plane.size() != buffer.iter.size()) {
+                    std::printf("%-40s %-20s %-8s FAIL: no %s plane\n", engineName.c_str(), name,
+                                PASS_NAMES[pass], PASS_NAMES[pass]);
+                    failures++;
+                    continue;
+                }
+                DiffStats diff = compare(golden, buffer);
+                if (pass == PASS_SMOOTH)
+                    comparePlane(golden, goldenSmooth, buffer, plane, options.smoothTolerance, false, diff);
+                else if (pass == PASS_DISTANCE)
+                    comparePlane(golden, goldenDistance, buffer, plane, options.distanceTolerance, true, diff);
+                double fraction = (double)diff.differing / golden.iter.size();
+                double planeFraction = (double)diff.planeDiffering / golden.iter.size();
+                bool ok = exact ? diff.differing + diff.planeDiffering == 0
+                                : fraction + planeFraction <= options.floatTolerance;
+                std::printf("%-40s %-20s %-8s %s: %zu px differ (%.3f%%), max |d| %u, mean |d| %.1f",
+                            engineName.c_str(), name, PASS_NAMES[pass], ok ? "ok" : "FAIL", diff.differing,
+                            fraction * 100, diff.maxAbs, diff.meanAbs);
+                if (withPlane)
+                    std::printf(", %zu px (%.3f%%) out of %s tolerance, max x%.2f", diff.planeDiffering,
+                                planeFraction * 100, PASS_NAMES[pass], diff.planeMax);
+                std::printf("\n");
+                if (!ok) failures++;
+            }
+        }
+        engine->setFormula(Formula());
+    }
+
+    std::printf("%d/%d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#include "histogram_color.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+Rgb equalizedColor(float t) {
+    return smoothPalette()[(int)(t * (PALETTE_SIZE - 1))];
+}
+
+void IterHistogram::add(const uint32_t *iter, size_t count) {
+    uint32_t last = counts_.size() - 1;
+    for (size_t i = 0; i < count; i++) counts_[std::min(iter[i], last)]++;
+}
+
+void IterHistogram::merge(const IterHistogram &other) {
+    for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+}
+
+std::vector<Rgb> IterHistogram::palette() const {
+    // Префиксная сумма последовательно: корзин maxIter + 1, это доли
+    // процента работы по сравнению с проходами по пикселям. Арифметика та
+    // же, что в histogram_cdf: uint-сумма, float-доля.
+    size_t escapedBins = counts_.size() - 1;
+    uint32_t total = 0;
+    for (size_t i = 0; i < escapedBins; i++) total += counts_[i];
+    float scale = total ? 1.0f / total : 0.0f;
+    std::vector<Rgb> lut(counts_.size());
+    uint32_t running = 0;
+    for (size_t i = 0; i < escapedBins; i++) {
+        running += counts_[i];
+        lut[i] = equalizedColor(running * scale);
+    }
+    lut.back() = {0, 0, 0};
+    return lut;
+}
+
+void equalizeHistogram(const IterationBuffer &in, int maxIter, int threads, std::vector<uint8_t> &rgb,
+                       EqualizeStats &stats) {
+    TRACE_SPAN("cpu equalize");
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t count = in.iter.size();
+    size_t chunk = (count + threads - 1) / threads;
+    // Каждый поток — свой непрерывный кусок буфера
+    auto parallel = [&](auto work) {
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; t++) pool.emplace_back(work, t);
+        work(0);
+        for (std::thread &thread : pool) thread.join();
+    };
+
+    // --- Проход 1: гистограммы по потокам, слияние ---
+    auto start = std::chrono::steady_clock::now();
+    std::vector<IterHistogram> partial(threads, IterHistogram(maxIter));
+    parallel([&](int t) {
+        size_t begin = std::min(count, t * chunk);
+        partial[t].add(in.iter.data() + begin, std::min(count, begin + chunk) - begin);
+    });
+    for (int t = 1; t < threads; t++) partial[0].merge(partial[t]);
+    stats.histogramMs = msSince(start);
+
+    // --- CDF в таблицу цветов ---
+    start = std::chrono::steady_clock::now();
+    PaletteLut lut(partial[0].palette());
+    stats.cdfMs = msSince(start);
+
+    // --- Проход 2: раскраска таблицей ---
+    start = std::chrono::steady_clock::now();
+    rgb.resize(count * 3);
+    parallel([&](int t) {
+        size_t begin = std::min(count, t * chunk);
+        lut.row(in.iter.data() + begin, (int)(std::min(count, begin + chunk) - begin), rgb.data() + begin * 3);
+    });
+    stats.mapMs = msSince(start);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "engine.h"
+#include "palette.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Раскраска выравниванием гистограммы ---
+// Палитра растягивается по доле пикселей, а не по числу итераций: цвет
+// убежавшего пикселя — доля убежавших пикселей кадра с числом итераций не
+// больше, чем у него (CDF гистограммы). На глубине, где все iter собраны в
+// узкой полосе у maxIter, контраст не пропадает; внутренность — чёрная.
+// Проходов два: гистограммы по потокам со слиянием и префиксная сумма в
+// таблицу на maxIter + 1 цветов, затем раскраска чтением из таблицы.
+// ClEngine делает то же ядрами iter_histogram, histogram_cdf и
+// histogram_map (cl_kernel.cpp) с той же арифметикой.
+
+// Цвет по доле t в [0, 1]: один период smoothPalette(), как в ядре
+Rgb equalizedColor(float t);
+
+// --- Гистограмма числа итераций: корзина на каждое значение 0..maxIter ---
+class IterHistogram {
+public:
+    explicit IterHistogram(int maxIter) : counts_(maxIter + 1) {}
+
+    // Значения больше maxIter идут в корзину maxIter
+    void add(const uint32_t *iter, size_t count);
+    void merge(const IterHistogram &other);
+    // Таблица цветов для всех iter от 0 до maxIter (последняя — чёрная)
+    std::vector<Rgb> palette() const;
+
+private:
+    std::vector<uint32_t> counts_;
+};
+
+// Весь кадр на threads потоках (0 — по числу ядер). rgb — 3 байта на
+// пиксель в порядке in (строки снизу вверх); время проходов — в stats.
+void equalizeHistogram(const IterationBuffer &in, int maxIter, int threads, std::vector<uint8_t> &rgb,
+                       EqualizeStats &stats);
@@ -0,0 +1,182 @@
+#include "kernel_cache.h"
+#include "cl_kernel.h"
+#include "palette.h"
+#include "trace.h"
+#include <iostream>
+#include <sstream>
+#include <tuple>
+
+std::string KernelConfig::buildOptions() const {
+    std::ostringstream opts;
+    if (maxIter > 0) opts << " -D SPEC_MAX_ITER=" << maxIter;
+    if (width > 0) opts << " -D SPEC_WIDTH=" << width;
+    if (height > 0) opts << " -D SPEC_HEIGHT=" << height;
+    opts << " -D SPEC_COLOR_MODE=" << colorMode;
+    if (useFloat) opts << " -D SPEC_FLOAT";
+    if (earlyOut) opts << " -D SPEC_EARLY_OUT";
+    return opts.str();
+}
+
+bool KernelConfig::operator<(const KernelConfig &other) const {
+    return std::tie(maxIter, width, height, colorMode, useFloat, earlyOut) <
+           std::tie(other.maxIter, other.width, other.height, other.colorMode, other.useFloat, other.earlyOut);
+}
+
+bool KernelConfig::operator==(const KernelConfig &other) const {
+    return !(*this < other) && !(other < *this);
+}
+
+KernelCache::KernelCache(cl_context context, cl_device_id device, const char *kernelName,
+                         const std::string &baseOptions, const Formula &formula)
+    : context_(context), device_(device), kernelName_(kernelName), baseOptions_(baseOptions), formula_(formula) {
+    thread_ = std::thread(&KernelCache::worker, this);
+}
+
+KernelCache::~KernelCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+
+    for (auto &entry : variants_) {
+        if (entry.second.kernel) clReleaseKernel(entry.second.kernel);
+        if (entry.second.program) clReleaseProgram(entry.second.program);
+    }
+    if (genericKernel_) clReleaseKernel(genericKernel_);
+    if (genericProgram_) clReleaseProgram(genericProgram_);
+}
+
+cl_kernel buildMandelbrot(cl_context context, cl_device_id device, const std::string &options,
+                          const char *kernelName, cl_program &program, const Formula &formula) {
+    cl_int err;
+    // Таблица COLOR_SMOOTH — перед ядром, одна на все варианты; за ней
+    // шаг формулы (у Mandelbrot пусто)
+    static const std::string palette = paletteKernelSource();
+    std::string formulaSource = formulaKernelSource(formula);
+    const char *sources[] = {palette.c_str(), formulaSource.c_str(), mandelbrotKernel};
+    program = clCreateProgramWithSource(context, 3, sources, nullptr, &err);
+    if (err != CL_SUCCESS) return nullptr;
+    err = clBuildProgram(program, 1, &device, options.c_str(), nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "kernel build failed (" << options << "):\n" << programBuildLog(program, device) << std::endl;
+        clReleaseProgram(program);
+        program = nullptr;
+        return nullptr;
+    }
+    cl_kernel kernel = clCreateKernel(program, kernelName, &err);
+    if (err != CL_SUCCESS) {
+        clReleaseProgram(program);
+        program = nullptr;
+        return nullptr;
+    }
+    return kernel;
+}
+
+void setMandelbrotArgs(cl_kernel kernel, cl_mem image, int width, int height, double centerX, double centerY,
+                       double zoom, int maxIter, int colorMode) {
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &image);
+    clSetKernelArg(kernel, 1, sizeof(int), &width);
+    clSetKernelArg(kernel, 2, sizeof(int), &height);
+    clSetKernelArg(kernel, 3, sizeof(double), &centerX);
+    clSetKernelArg(kernel, 4, sizeof(double), &centerY);
+    clSetKernelArg(kernel, 5, sizeof(double), &zoom);
+    clSetKernelArg(kernel, 6, sizeof(int), &maxIter);
+    clSetKernelArg(kernel, 7, sizeof(int), &colorMode);
+}
+
+std::string kernelStatsOptions() {
+    return " -D SPEC_STATS -D STATS_BINS=" + std::to_string(WorkStats::HISTOGRAM_BINS);
+}
+
+WorkStats kernelStats(const cl_uint *words, uint64_t pixels, int maxIter) {
+    WorkStats stats;
+    stats.reset(maxIter);
+    stats.iterations = ((uint64_t)words[1] << 32) | words[0];
+    stats.escaped = words[2];
+    stats.skipped = words[3];
+    stats.interior = words[4];
+    // Ядро, запущенное шире переданного прямоугольника, насчитает убежавших
+    // больше его пикселей
+    stats.maxed = pixels > stats.escaped ? pixels - stats.escaped : 0;
+    for (int i = 0; i < WorkStats::HISTOGRAM_BINS; i++) stats.histogram[i] = words[5 + i];
+    return stats;
+}
+
+bool KernelCache::buildGeneric() {
+    genericKernel_ =
+        buildMandelbrot(context_, device_, baseOptions_, kernelName_.c_str(), genericProgram_, formula_);
+    return genericKernel_ != nullptr;
+}
+
+cl_kernel KernelCache::select(const KernelConfig &config) {
+    frame_++;
+    streak_ = (config == last_) ? streak_ + 1 : 1;
+    last_ = config;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = variants_.find(config);
+    if (it == variants_.end()) {
+        if (streak_ >= HOT_FRAMES) {
+            variants_[config].lastUsed = frame_;
+            jobs_.push_back(config);
+            wake_.notify_one();
+        }
+        return genericKernel_;
+    }
+    // Ещё собирается или не собрался: повторной сборки нет, кадр рисует общий
+    if (!it->second.ready || it->second.failed) return genericKernel_;
+    it->second.lastUsed = frame_;
+    return it->second.kernel;
+}
+
+// Выбрасываем давно не использованные готовые варианты сверх MAX_VARIANTS.
+// Вызывается из рабочего потока под mutex_; ядро, выбранное на текущий кадр,
+// всегда имеет самый свежий lastUsed и не вытесняется.
+void KernelCache::evict() {
+    size_t ready = 0;
+    for (auto &entry : variants_) ready += entry.second.ready;
+    while (ready > MAX_VARIANTS) {
+        auto oldest = variants_.end();
+        for (auto it = variants_.begin(); it != variants_.end(); ++it)
+            if (it->second.ready && (oldest == variants_.end() || it->second.lastUsed < oldest->second.lastUsed)) oldest = it;
+        clReleaseKernel(oldest->second.kernel);
+        clReleaseProgram(oldest->second.program);
+        variants_.erase(oldest);
+        ready--;
+    }
+}
+
+void KernelCache::worker() {
+    traceSetThreadName("kernel builder");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_) return;
+        KernelConfig config = jobs_.front();
+        jobs_.pop_front();
+
+        // Компиляция может занимать секунды — без блокировки
+        lock.unlock();
+        cl_program program = nullptr;
+        cl_kernel kernel;
+        {
+            TRACE_SPAN("build kernel variant");
+            kernel = buildMandelbrot(context_, device_, baseOptions_ + config.buildOptions(), kernelName_.c_str(),
+                                     program, formula_);
+        }
+        lock.lock();
+
+        Variant &variant = variants_[config];
+        variant.program = program;
+        variant.kernel = kernel;
+        variant.ready = kernel != nullptr;
+        variant.failed = kernel == nullptr;
+        // Лог сборки уже напечатан; запись остаётся, чтобы select не ставил
+        // вариант в очередь снова
+        if (variant.failed)
+            std::cerr << "kernel variant" << config.buildOptions() << " failed, using the generic kernel" << std::endl;
+        if (variant.ready) evict();
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "cl_utils.h"
+#include "formula.h"
+#include "work_stats.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// --- Параметры кадра, которые можно зашить в ядро через -D ---
+struct KernelConfig {
+    int maxIter = 0;
+    int width = 0;
+    int height = 0;
+    int colorMode = 0;
+    bool useFloat = false;  // точности float хватает на небольших увеличениях
+    bool earlyOut = false;  // проверка кардиоиды и круга периода 2
+
+    std::string buildOptions() const;
+    bool operator<(const KernelConfig &other) const;
+    bool operator==(const KernelConfig &other) const;
+};
+
+// --- Сборка программы из mandelbrotKernel и создание ядра kernelName ---
+// formula — формула итераций (formula.h), по умолчанию Mandelbrot.
+// При ошибке печатает лог сборки и возвращает nullptr
+cl_kernel buildMandelbrot(cl_context context, cl_device_id device, const std::string &options,
+                          const char *kernelName, cl_program &program, const Formula &formula = Formula());
+
+// --- Аргументы ядра mandelbrot (одинаковые у всех вариантов) ---
+void setMandelbrotArgs(cl_kernel kernel, cl_mem image, int width, int height, double centerX, double centerY,
+                       double zoom, int maxIter, int colorMode);
+
+// --- Статистика работы ядра (SPEC_STATS) ---
+// Буфер из KERNEL_STATS_WORDS uint: итерации (младшее и старшее слово),
+// убежавшие, пропущенные, пойманные проверкой производной, гистограмма.
+// enqueueFrame обнуляет его сам.
+const int KERNEL_STATS_WORDS = 5 + WorkStats::HISTOGRAM_BINS;
+
+// -D опции, включающие статистику во всех ядрах
+std::string kernelStatsOptions();
+
+// Разбор прочитанного буфера; pixels — размер кадра
+WorkStats kernelStats(const cl_uint *words, uint64_t pixels, int maxIter);
+
+// --- Кэш специализированных вариантов ядра ---
+// Общий вариант (всё передаётся аргументами) собирается сразу и рисует
+// кадры, пока вариант для "горячей" конфигурации компилируется в фоновом
+// потоке. Готовый вариант подменяет общий со следующего кадра. Сигнатура
+// у всех вариантов одинаковая, поэтому аргументы выставляются как обычно.
+class KernelCache {
+public:
+    // Сколько кадров подряд конфигурация должна продержаться, чтобы её собрать
+    static const int HOT_FRAMES = 30;
+    // Сколько готовых вариантов держим одновременно
+    static const size_t MAX_VARIANTS = 8;
+
+    // baseOptions добавляются ко всем вариантам (например, настройки автотюнера);
+    // formula — формула итераций всех вариантов
+    KernelCache(cl_context context, cl_device_id device, const char *kernelName,
+                const std::string &baseOptions = "", const Formula &formula = Formula());
+    ~KernelCache();
+
+    // Синхронная сборка общего варианта; при ошибке печатает лог
+    bool buildGeneric();
+
+    // Ядро для кадра с данной конфигурацией: специализированное, если оно
+    // уже собрано, иначе общее
+    cl_kernel select(const KernelConfig &config);
+
+private:
+    struct Variant {
+        cl_program program = nullptr;
+        cl_kernel kernel = nullptr;
+        bool ready = false;
+        bool failed = false;  // сборка не удалась: не пересобирается
+        uint64_t lastUsed = 0;
+    };
+
+    void evict();
+    void worker();
+
+    cl_context context_;
+    cl_device_id device_;
+    std::string kernelName_;
+    std::string baseOptions_;
+    Formula formula_;
+
+    cl_program genericProgram_ = nullptr;
+    cl_kernel genericKernel_ = nullptr;
+
+    KernelConfig last_;
+    int streak_ = 0;
+    uint64_t frame_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::map<KernelConfig, Variant> variants_;
+    std::deque<KernelConfig> jobs_;
+    bool stop_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,134 @@
+// --- Поиск миниброта в виде для автоматического погружения ---
+// Использование: locate [--view имя] [--center X,Y] [--zoom Z] [--size WxH]
+//                       [--grid N] [--min-period N] [--max-period N]
+//                       [--bits N] [--digits N]
+// В сетке --grid строк по виду ищутся атомные домены (nucleus.h); ядро
+// миниброта уточняется Ньютоном в GMP, начиная с наименьшего периода, —
+// первое ядро в кадре и есть ответ. Вывод — строки "ключ значение" для
+// скриптов:
+//   period   период миниброта
+//   bits     точность, с которой уточнено ядро
+//   center   центр (re im) с --digits знаками (по умолчанию — на 10 знаков
+//            мельче размера)
+//   size     оценка размера и angle — поворот миниброта в радианах
+//   offset   расстояние ядра от центра вида в высотах вида
+//   args     --center/--zoom для poster и т.п., миниброт во весь кадр
+// Следующий миниброт по пути вглубь — тот же запуск из найденного вида с
+// --min-period на единицу больше найденного периода.
+#include "nucleus.h"
+#include "views.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// Во сколько раз высота вида больше размера миниброта в args: кардиоида с
+// кругами и антенной шире самой кардиоиды примерно в 2.5 раза
+const double FRAME_SIZES = 3.0;
+
+struct Options {
+    View view;
+    int grid = 64;
+    int minPeriod = 1;
+    int maxPeriod = 0;  // 0 — view.maxIter
+    int bits = 0;       // 0 — по zoom
+    int digits = 0;     // 0 — по размеру миниброта
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) return false;
+        if (std::strcmp(arg, "--view") == 0) {
+            const NamedView *named = findView(value);
+            if (!named) return false;
+            options.view = named->view;
+        } else if (std::strcmp(arg, "--center") == 0) {
+            if (std::sscanf(value, "%lf,%lf", &options.view.centerX, &options.view.centerY) != 2) return false;
+        } else if (std::strcmp(arg, "--zoom") == 0) {
+            options.view.zoom = std::atof(value);
+        } else if (std::strcmp(arg, "--size") == 0) {
+            if (std::sscanf(value, "%dx%d", &options.view.width, &options.view.height) != 2) return false;
+        } else if (std::strcmp(arg, "--grid") == 0) {
+            options.grid = std::atoi(value);
+        } else if (std::strcmp(arg, "--min-period") == 0) {
+            options.minPeriod = std::atoi(value);
+        } else if (std::strcmp(arg, "--max-period") == 0) {
+            options.maxPeriod = std::atoi(value);
+        } else if (std::strcmp(arg, "--bits") == 0) {
+            options.bits = std::atoi(value);
+        } else if (std::strcmp(arg, "--digits") == 0) {
+            options.digits = std::atoi(value);
+        } else {
+            return false;
+        }
+        i++;
+    }
+    if (options.maxPeriod <= 0) options.maxPeriod = options.view.maxIter;
+    return options.view.zoom > 0 && options.view.width > 0 && options.view.height > 0 && options.grid > 0 &&
+           options.minPeriod > 0 && options.maxPeriod >= options.minPeriod && options.bits >= 0 &&
+           options.digits >= 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: locate [--view name] [--center X,Y] [--zoom Z] [--size WxH] [--grid N] [--min-period N]"
+                     " [--max-period N] [--bits N] [--digits N]"
+                  << std::endl;
+        return 2;
+    }
+    const View &view = options.view;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<AtomDomain> domains = findAtomDomains(view, options.grid, options.minPeriod, options.maxPeriod);
+    double searchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Сетка различает точки до шага ~zoom/grid: столько бит и нужно для
+    // начального приближения, остальное Ньютон добавит сам
+    int bits = options.bits > 0 ? options.bits : 64 + (int)std::ceil(std::log2(options.grid / view.zoom));
+    start = std::chrono::steady_clock::now();
+    Nucleus nucleus;
+    bool found = false;
+    int tried = 0, steps = 0;
+    for (const AtomDomain &domain : domains) {
+        tried++;
+        bool converged = refineNucleus(domain.re, domain.im, domain.period, bits, options.digits, nucleus);
+        steps += nucleus.steps;
+        // Ядро меньшего периода уже не то, что искали
+        if (converged && nucleus.period >= options.minPeriod && inView(view, nucleus.centerX, nucleus.centerY)) {
+            found = true;
+            break;
+        }
+    }
+    double newtonMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu atom domains on %dx%d grid %.1f ms, newton %d steps for %d of them %.1f ms\n",
+                 domains.size(), (int)std::lround((double)options.grid * view.width / view.height), options.grid,
+                 searchMs, steps, tried, newtonMs);
+    if (!found) {
+        std::cerr << "no nucleus in view with period in [" << options.minPeriod << ", " << options.maxPeriod << "]"
+                  << std::endl;
+        return 1;
+    }
+
+    double offset = std::hypot(nucleus.centerX - view.centerX, nucleus.centerY - view.centerY) / view.zoom;
+    std::printf("period %d\n", nucleus.period);
+    std::printf("bits %d\n", nucleus.bits);
+    std::printf("center %s %s\n", nucleus.re.c_str(), nucleus.im.c_str());
+    std::printf("size %s\n", nucleus.size.c_str());
+    std::printf("angle %.4f\n", nucleus.angle);
+    std::printf("offset %.3f\n", offset);
+    if (nucleus.sizeValue > 0)
+        std::printf("args --center %.17g,%.17g --zoom %.6g\n", nucleus.centerX, nucleus.centerY,
+                    nucleus.sizeValue * FRAME_SIZES);
+    return 0;
+}
@@ -4,56 +4,33 @@
 #include <GLFW/glfw3.h>
 #include <CL/cl.h>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <cstring>
 #include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include "autotune.h"
+#include "cl_kernel.h"
+#include "formula.h"
+#include "frame_stats.h"
+#include "kernel_cache.h"
+#include "progressive.h"
+#include "trace.h"
+#include "view.h"
 // clang-format on
 
 // --- Параметры окна и Мандельброта ---
 const int WIDTH = 800;
 const int HEIGHT = 600;
 int MAX_ITER = 500;
+bool autoMaxIterEnabled = true;  // MAX_ITER по статистике прошлого кадра (клавиша M)
 double centerX = -0.5, centerY = 0.0, zoom = 2.0;
+int colorMode = COLOR_POLY;
 
-// --- OpenCL ядро ---
-const char *mandelbrotKernel = R"(
-#ifdef cl_khr_fp64
-#pragma OPENCL EXTENSION cl_khr_fp64 : enable
-#elif defined(cl_amd_fp64)
-#pragma OPENCL EXTENSION cl_amd_fp64 : enable
-#else
-#error "Double precision floating point not supported by OpenCL implementation."
-#endif
-
-__kernel void mandelbrot(
-    __global uchar4* image,
-    const int width,
-    const int height,
-    const double centerX,
-    const double centerY,
-    const double zoom,
-    const int maxIter)
-{
-    int x = get_global_id(0);
-    int y = get_global_id(1);
-    double scale = zoom / (double)height;
-    double real = centerX + (x - width/2.0) * scale;
-    double imag = centerY + (y - height/2.0) * scale;
-    double zr = 0.0, zi = 0.0;
-    int iter = 0;
-    while(zr*zr + zi*zi < 4.0 && iter < maxIter){
-        double tmp = zr*zr - zi*zi + real;
-        zi = 2.0*zr*zi + imag;
-        zr = tmp;
-        iter++;
-    }
-    float t = (float)iter / maxIter;
-    uchar r = (uchar)(9*(1-t)*t*t*t*255);
-    uchar g = (uchar)(15*(1-t)*(1-t)*t*t*255);
-    uchar b = (uchar)(8.5*(1-t)*(1-t)*(1-t)*t*255);
-    image[y*width + x] = (uchar4)(r,g,b,255);
-}
-)";
+// Если полный кадр считается дольше, при зуме и сдвиге сразу показываем
+// превью из прошлого кадра и досчитываем его плитками в пределах бюджета
+const double FRAME_BUDGET_MS = 12.0;
 
 // --- Создание OpenGL текстуры ---
 GLuint createTexture(int w, int h) {
@@ -66,8 +43,20 @@ GLuint createTexture(int w, int h) {
     return tex;
 }
 
+// --- Интервал выполнения команды OpenCL на дорожке очереди в трассе ---
+// Часы устройства переводятся в часы хоста по моменту постановки в очередь
+void traceClEvent(const char *name, cl_event event, uint64_t hostQueued) {
+    cl_ulong queued = 0, start = 0, end = 0;
+    if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, nullptr) != CL_SUCCESS ||
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) != CL_SUCCESS ||
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) != CL_SUCCESS)
+        return;
+    traceRecord(name, hostQueued + (start - queued), hostQueued + (end - queued), "OpenCL queue");
+}
+
 // --- GLFW обработка ввода ---
 void processInput(GLFWwindow *window) {
+    TRACE_SPAN("processInput");
     double moveSpeed = zoom * 0.01;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) centerY += moveSpeed;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) centerY -= moveSpeed;
@@ -75,17 +64,66 @@ void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) centerX += moveSpeed;
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) zoom *= 0.95;
     if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) zoom *= 1.05;
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) MAX_ITER = std::min(MAX_ITER + 5, 1000);
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) MAX_ITER = std::max(MAX_ITER - 5, 10);
+    // Стрелки задают MAX_ITER вручную и выключают автоподбор
+    int iterStep = std::max(5, MAX_ITER / 50);
+    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
+        MAX_ITER = std::min(MAX_ITER + iterStep, AUTO_MAX_ITER_LIMIT);
+        autoMaxIterEnabled = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
+        MAX_ITER = std::max(MAX_ITER - iterStep, 10);
+        autoMaxIterEnabled = false;
+    }
+    static bool autoHeld = false;
+    bool autoPressed = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+    if (autoPressed && !autoHeld) autoMaxIterEnabled = !autoMaxIterEnabled;
+    autoHeld = autoPressed;
+    if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) colorMode = COLOR_POLY;
+    if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) colorMode = COLOR_HSV;
+    if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) colorMode = COLOR_SMOOTH;
+    // F12 — сохранить трассу последних кадров (открывается в chrome://tracing или Perfetto);
+    // трасса пишется только с --trace
+    static bool dumpHeld = false;
+    bool dumpPressed = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+    if (dumpPressed && !dumpHeld) {
+        std::string path = "trace-" + std::to_string(std::time(nullptr)) + ".json";
+        if (!traceEnabled()) std::cout << "tracing is off, start with --trace" << std::endl;
+        else if (traceDump(path)) std::cout << "trace written to " << path << std::endl;
+    }
+    dumpHeld = dumpPressed;
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
         centerX = -0.5;
         centerY = 0.0;
         zoom = 2.0;
         MAX_ITER = 500;
+        autoMaxIterEnabled = true;
     }
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // --retune: заново подобрать параметры запуска ядра
+    // --iter-block N: итераций между проверками выхода вместо подобранного
+    // --formula формула: mandelbrot (по умолчанию), julia:X,Y, multibrot:N
+    // или burning-ship (formula.h) — на весь сеанс
+    // --trace: записывать трассу кадров (сохраняется по F12)
+    bool retune = false;
+    int iterBlock = 0;
+    Formula formula;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--retune") == 0) retune = true;
+        else if (std::strcmp(argv[i], "--trace") == 0) traceSetEnabled(true);
+        else if (std::strcmp(argv[i], "--iter-block") == 0 && i + 1 < argc) iterBlock = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--formula") == 0 && i + 1 < argc) {
+            if (!parseFormula(argv[++i], formula)) {
+                std::cerr << "unknown formula " << argv[i] << " (mandelbrot, julia:X,Y, multibrot:N, burning-ship)"
+                          << std::endl;
+                return 2;
+            }
+        }
+    }
+
+    traceSetThreadName("main");
+
     // --- GLFW + OpenGL ---
     if (!glfwInit()) return -1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -105,47 +143,173 @@ int main() {
     cl_device_id device;
     clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, nullptr);
     cl_context context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
-    cl_command_queue queue = clCreateCommandQueue(context, device, 0, &err);
-
-    cl_program program = clCreateProgramWithSource(context, 1, &mandelbrotKernel, nullptr, &err);
-    err = clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr);
-    if (err != CL_SUCCESS) {
-        size_t logSize;
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
-        std::string log(logSize, '\0');
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, logSize, &log[0], nullptr);
-        std::cerr << log << std::endl;
-        return -1;
+    cl_command_queue queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+
+    TuneConfig tune = autotune(context, device, queue, WIDTH, HEIGHT, retune);
+    if (iterBlock > 0) {
+        tune = standardTune(tune);
+        tune.iterBlock = iterBlock;
+        tune.unroll = 1;
     }
+    // Параметры запуска подобраны на Mandelbrot: у других формул та же
+    // структура цикла, меняется лишь шаг
+    KernelCache kernels(context, device, tune.kernelName(), tune.buildOptions() + kernelStatsOptions(), formula);
+    if (!kernels.buildGeneric()) return -1;
 
-    cl_kernel kernel = clCreateKernel(program, "mandelbrot", &err);
-    std::vector<cl_uchar4> buffer(WIDTH * HEIGHT);
+    // Плитки считает обычное ядро: persistent разбирает только кадр целиком
+    TuneConfig tileTune = standardTune(tune, TileQueue::TILE);
+    std::unique_ptr<KernelCache> ownTileKernels;
+    KernelCache *tileKernels = &kernels;
+    if (tune.persistent) {
+        ownTileKernels = std::make_unique<KernelCache>(context, device, tileTune.kernelName(),
+                                                       tileTune.buildOptions() + kernelStatsOptions(), formula);
+        if (!ownTileKernels->buildGeneric()) return -1;
+        tileKernels = ownTileKernels.get();
+    }
+
+    std::vector<cl_uchar4> buffer(WIDTH * HEIGHT), preview;
+    cl_mem clBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uchar4) * buffer.size(), nullptr, &err);
+    cl_mem counter = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int), nullptr, &err);
+    cl_mem statsBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * KERNEL_STATS_WORDS, nullptr, &err);
+    cl_uint statsWords[KERNEL_STATS_WORDS];
+
+    // --- Что сейчас в buffer и сколько стоит полный кадр ---
+    View shownView;
+    shownView.width = WIDTH;
+    shownView.height = HEIGHT;
+    int shownColorMode = colorMode;
+    bool haveFrame = false;
+    double fullFrameMs = 0;  // время ядра последнего полного кадра
+    TileQueue tiles(WIDTH, HEIGHT);
+    WorkStats tileStats;
+    double tileKernelMs = 0;  // сумма по плиткам текущего кадра
+
+    // --- Время этапов кадра: в заголовке окна и периодически в консоли ---
+    FrameTimings timings;
+    double lastTitle = glfwGetTime(), lastReport = lastTitle;
 
     // --- Основной цикл ---
     while (!glfwWindowShouldClose(window)) {
+        TRACE_SPAN("frame");
+        double frameStart = glfwGetTime();
         processInput(window);
 
-        cl_mem clBuffer = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_MEM_COPY_HOST_PTR,
-                                         sizeof(cl_uchar4) * buffer.size(), buffer.data(), &err);
+        View view;
+        view.centerX = centerX;
+        view.centerY = centerY;
+        view.zoom = zoom;
+        view.width = WIDTH;
+        view.height = HEIGHT;
+        view.maxIter = MAX_ITER;
+        // Сдвинулся ли вид. maxIter не в счёт: его меняет autoMaxIter после
+        // последней плитки, и неподвижный вид пересчитывался бы по плиткам
+        // заново раз за разом; новый предел действует с ближайшего кадра
+        View geometry = view;
+        geometry.maxIter = shownView.maxIter;
+        bool changed = !haveFrame || geometry != shownView || colorMode != shownColorMode;
 
-        clSetKernelArg(kernel, 0, sizeof(cl_mem), &clBuffer);
-        clSetKernelArg(kernel, 1, sizeof(int), &WIDTH);
-        clSetKernelArg(kernel, 2, sizeof(int), &HEIGHT);
-        clSetKernelArg(kernel, 3, sizeof(double), &centerX);
-        clSetKernelArg(kernel, 4, sizeof(double), &centerY);
-        clSetKernelArg(kernel, 5, sizeof(double), &zoom);
-        clSetKernelArg(kernel, 6, sizeof(int), &MAX_ITER);
+        // Специализированный вариант ядра под текущий кадр, если уже собран
+        KernelConfig config;
+        config.maxIter = MAX_ITER;
+        config.width = WIDTH;
+        config.height = HEIGHT;
+        config.colorMode = colorMode;
+        config.useFloat = zoom / HEIGHT > FLOAT_SCALE_LIMIT;
+        config.earlyOut = formula.kind == FORMULA_MANDELBROT;
 
-        size_t global[2] = {WIDTH, HEIGHT};
-        clEnqueueNDRangeKernel(queue, kernel, 2, nullptr, global, nullptr, 0, nullptr, nullptr);
-        clEnqueueReadBuffer(queue, clBuffer, CL_TRUE, 0, sizeof(cl_uchar4) * buffer.size(), buffer.data(), 0, nullptr, nullptr);
-        clReleaseMemObject(clBuffer);
+        if (changed && haveFrame && fullFrameMs > FRAME_BUDGET_MS) {
+            // Кадр не успеть за бюджет: показываем прошлый, пересэмплированный
+            // в новый вид, и начинаем плитки с центра
+            TRACE_SPAN("resample preview");
+            resampleView(buffer, shownView, preview, view);
+            buffer.swap(preview);
+            tiles.restart();
+            tileStats.reset(MAX_ITER);
+            tileKernelMs = 0;
+        }
+        shownView = view;
+        shownColorMode = colorMode;
+        haveFrame = true;
+
+        if (!tiles.done()) {
+            // --- Плитки, пока не кончился бюджет кадра (хотя бы одна) ---
+            cl_kernel kernel = tileKernels->select(config);
+            setMandelbrotArgs(kernel, clBuffer, WIDTH, HEIGHT, centerX, centerY, zoom, MAX_ITER, colorMode);
+            double frameKernelMs = 0, frameReadMs = 0;
+            int x, y, w, h;
+            do {
+                tiles.next(x, y, w, h);
+                cl_event kernelDone = nullptr, readDone = nullptr;
+                uint64_t enqueued = traceNow();
+                enqueueTile(queue, kernel, device, tileTune, x, y, w, h, &kernelDone, statsBuffer);
+                clEnqueueReadBuffer(queue, statsBuffer, CL_FALSE, 0, sizeof(statsWords), statsWords, 0, nullptr,
+                                    nullptr);
+                size_t origin[3] = {x * sizeof(cl_uchar4), (size_t)y, 0};
+                size_t region[3] = {w * sizeof(cl_uchar4), (size_t)h, 1};
+                size_t pitch = WIDTH * sizeof(cl_uchar4);
+                clEnqueueReadBufferRect(queue, clBuffer, CL_TRUE, origin, origin, region, pitch, 0, pitch, 0,
+                                        buffer.data(), 0, nullptr, &readDone);
+                tileStats.merge(kernelStats(statsWords, (uint64_t)w * h, MAX_ITER));
+                if (kernelDone) {
+                    frameKernelMs += eventMs(kernelDone);
+                    traceClEvent("kernel tile", kernelDone, enqueued);
+                    clReleaseEvent(kernelDone);
+                }
+                if (readDone) {
+                    frameReadMs += eventMs(readDone);
+                    traceClEvent("readback tile", readDone, enqueued);
+                    clReleaseEvent(readDone);
+                }
+            } while (!tiles.done() && (glfwGetTime() - frameStart) * 1000.0 < FRAME_BUDGET_MS);
+            timings.record(STAGE_KERNEL, frameKernelMs);
+            timings.record(STAGE_READBACK, frameReadMs);
+            tileKernelMs += frameKernelMs;
+            if (tiles.done()) {
+                fullFrameMs = tileKernelMs;
+                if (autoMaxIterEnabled) MAX_ITER = autoMaxIter(tileStats);
+            }
+        } else {
+            // --- Полный кадр ---
+            cl_kernel kernel = kernels.select(config);
+            cl_event kernelDone = nullptr, readDone = nullptr;
+            uint64_t enqueued = traceNow();
+            {
+                TRACE_SPAN("enqueue kernel");
+                setMandelbrotArgs(kernel, clBuffer, WIDTH, HEIGHT, centerX, centerY, zoom, MAX_ITER, colorMode);
+                enqueueFrame(queue, kernel, device, tune, WIDTH, HEIGHT, counter, &kernelDone, statsBuffer);
+            }
+            {
+                TRACE_SPAN("wait kernel + readback");
+                clEnqueueReadBuffer(queue, statsBuffer, CL_FALSE, 0, sizeof(statsWords), statsWords, 0, nullptr,
+                                    nullptr);
+                clEnqueueReadBuffer(queue, clBuffer, CL_TRUE, 0, sizeof(cl_uchar4) * buffer.size(), buffer.data(), 0,
+                                    nullptr, &readDone);
+            }
+            if (autoMaxIterEnabled) MAX_ITER = autoMaxIter(kernelStats(statsWords, buffer.size(), MAX_ITER));
+            if (kernelDone) {
+                fullFrameMs = eventMs(kernelDone);
+                timings.record(STAGE_KERNEL, fullFrameMs);
+                traceClEvent("kernel", kernelDone, enqueued);
+                clReleaseEvent(kernelDone);
+            }
+            if (readDone) {
+                timings.record(STAGE_READBACK, eventMs(readDone));
+                traceClEvent("readback", readDone, enqueued);
+                clReleaseEvent(readDone);
+            }
+        }
 
         // --- Загрузка в OpenGL текстуру ---
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+        double uploadStart = glfwGetTime();
+        {
+            TRACE_SPAN("texture upload");
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+        }
+        timings.record(STAGE_UPLOAD, (glfwGetTime() - uploadStart) * 1000.0);
 
         // --- Рендеринг через современные OpenGL ---
+        uint64_t drawStart = traceNow();
         glClear(GL_COLOR_BUFFER_BIT);
 
         static GLuint vao = 0, vbo = 0;
@@ -170,8 +334,29 @@ int main() {
 
         glBindVertexArray(vao);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        traceRecord("draw", drawStart, traceNow());
+
+        double swapStart = glfwGetTime();
+        {
+            TRACE_SPAN("swap");
+            glfwSwapBuffers(window);
+        }
+        double now = glfwGetTime();
+        timings.record(STAGE_SWAP, (now - swapStart) * 1000.0);
+        timings.record(STAGE_FRAME, (now - frameStart) * 1000.0);
+
+        if (now - lastTitle > 0.5) {
+            std::string title = "Mandelbrot OpenCL+OpenGL | " + formulaName(formula) + " | " + timings.summary() +
+                                " | iter " + std::to_string(MAX_ITER) + (autoMaxIterEnabled ? " (auto)" : "");
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitle = now;
+        }
+        if (now - lastReport > 5.0) {
+            std::cout << timings.table() << std::endl;
+            lastReport = now;
+        }
 
-        glfwSwapBuffers(window);
+        TRACE_SPAN("poll events");
         glfwPollEvents();
     }
 
@@ -0,0 +1,209 @@
+#include "nucleus.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <gmpxx.h>
+#include <map>
+
+namespace {
+
+const int MAX_NEWTON_STEPS = 64;
+// Точность сверх log2(1/размер): на ошибки округления по орбите и чтобы
+// ядро было точнее размера миниброта с большим запасом
+const int GUARD_BITS = 64;
+// Знаков после точки, с которыми центр переводится в double
+const int DOUBLE_PLACES = 40;
+
+// Период атомного домена точки: номер итерации с наименьшим |z| среди
+// [minPeriod, maxPeriod] (до выхода за радиус 2); norm — этот |z|^2
+int atomPeriod(double cr, double ci, int minPeriod, int maxPeriod, double &norm) {
+    double zr = 0, zi = 0;
+    int period = 0;
+    norm = HUGE_VAL;
+    for (int n = 1; n <= maxPeriod; n++) {
+        double tmp = zr * zr - zi * zi + cr;
+        zi = 2.0 * zr * zi + ci;
+        zr = tmp;
+        double r2 = zr * zr + zi * zi;
+        if (n >= minPeriod && r2 < norm) {
+            norm = r2;
+            period = n;
+        }
+        if (r2 > 4.0) break;
+    }
+    return period;
+}
+
+// Шаг Ньютона c -= z_p(c) / z_p'(c); результат — |шага|^2 (отрицательный,
+// если производная нулевая и шаг невозможен)
+mpf_class newtonStep(mpf_class &cr, mpf_class &ci, int period, mp_bitcnt_t bits) {
+    mpf_class zr(0, bits), zi(0, bits), dr(0, bits), di(0, bits), tmp(0, bits);
+    for (int i = 0; i < period; i++) {
+        tmp = 2 * (zr * dr - zi * di) + 1;
+        di = 2 * (zr * di + zi * dr);
+        dr = tmp;
+        tmp = zr * zr - zi * zi + cr;
+        zi = 2 * zr * zi + ci;
+        zr = tmp;
+    }
+    mpf_class d2(dr * dr + di * di, bits);
+    if (d2 == 0) return mpf_class(-1, bits);
+    // z / dz = z * conj(dz) / |dz|^2
+    mpf_class sr((zr * dr + zi * di) / d2, bits), si((zi * dr - zr * di) / d2, bits);
+    cr -= sr;
+    ci -= si;
+    return mpf_class(sr * sr + si * si, bits);
+}
+
+// Ньютон для z_p = 0 сходится и к ядрам периодов-делителей p (там z_p
+// тоже 0): настоящий период — наименьший делитель k с z_k = 0
+int primitivePeriod(const mpf_class &cr, const mpf_class &ci, int period, mp_bitcnt_t bits) {
+    mpf_class zr(0, bits), zi(0, bits), tmp(0, bits), eps2(1, bits);
+    mpf_div_2exp(eps2.get_mpf_t(), eps2.get_mpf_t(), bits);
+    for (int k = 1; k < period; k++) {
+        tmp = zr * zr - zi * zi + cr;
+        zi = 2 * zr * zi + ci;
+        zr = tmp;
+        if (period % k == 0 && zr * zr + zi * zi < eps2) return k;
+    }
+    return period;
+}
+
+// Оценка размера миниброта с ядром c (как m_d_size в mandelbrot-numerics):
+// l = z_p'(z_1) вдоль цикла, b = сумма 1/l_k, размер s = 1 / (b l^2).
+// log2Size — log2|s| (без переполнения double); angle — arg s.
+void atomSize(const mpf_class &cr, const mpf_class &ci, int period, mp_bitcnt_t bits, mpf_class &size,
+              double &log2Size, double &angle) {
+    mpf_class zr(0, bits), zi(0, bits), lr(1, bits), li(0, bits), br(1, bits), bi(0, bits), tmp(0, bits), l2(0, bits);
+    for (int i = 1; i < period; i++) {
+        tmp = zr * zr - zi * zi + cr;
+        zi = 2 * zr * zi + ci;
+        zr = tmp;
+        tmp = 2 * (zr * lr - zi * li);
+        li = 2 * (zr * li + zi * lr);
+        lr = tmp;
+        // 1/l = conj(l) / |l|^2
+        l2 = lr * lr + li * li;
+        br += lr / l2;
+        bi -= li / l2;
+    }
+    l2 = lr * lr + li * li;
+    mpf_class b2(br * br + bi * bi, bits);
+    size = 1 / (sqrt(b2) * l2);
+    long exp2 = 0;
+    double mantissa = mpf_get_d_2exp(&exp2, size.get_mpf_t());
+    log2Size = std::log2(mantissa) + exp2;
+    angle = -(std::atan2(bi.get_d(), br.get_d()) + 2 * std::atan2(li.get_d(), lr.get_d()));
+    angle = std::remainder(angle, 2 * M_PI);
+}
+
+// Десятичная запись с places знаками после точки
+std::string fixedString(const mpf_class &x, int places) {
+    mp_exp_t exp10 = 0;
+    char *first = mpf_get_str(nullptr, &exp10, 10, 1, x.get_mpf_t());
+    std::free(first);
+    long count = (long)exp10 + places;
+    if (x == 0 || count <= 0) return "0";
+    char *raw = mpf_get_str(nullptr, &exp10, 10, count, x.get_mpf_t());
+    std::string digits = raw;
+    std::free(raw);
+    std::string sign;
+    if (digits[0] == '-') {
+        sign = "-";
+        digits.erase(0, 1);
+    }
+    // digits — мантисса 0.digits * 10^exp10 без хвостовых нулей
+    if (exp10 <= 0) return sign + "0." + std::string(-exp10, '0') + digits;
+    if ((long)digits.size() <= exp10) return sign + digits + std::string(exp10 - digits.size(), '0');
+    return sign + digits.substr(0, exp10) + "." + digits.substr(exp10);
+}
+
+// Экспоненциальная запись с digits значащими цифрами (1.23e-45)
+std::string scientificString(const mpf_class &x, int digits) {
+    if (x == 0) return "0";
+    mp_exp_t exp10 = 0;
+    char *raw = mpf_get_str(nullptr, &exp10, 10, digits, x.get_mpf_t());
+    std::string mantissa = raw;
+    std::free(raw);
+    std::string sign;
+    if (mantissa[0] == '-') {
+        sign = "-";
+        mantissa.erase(0, 1);
+    }
+    std::string text = sign + mantissa.substr(0, 1);
+    if (mantissa.size() > 1) text += "." + mantissa.substr(1);
+    return text + "e" + std::to_string((long)exp10 - 1);
+}
+
+}  // namespace
+
+std::vector<AtomDomain> findAtomDomains(const View &view, int rows, int minPeriod, int maxPeriod) {
+    std::map<int, AtomDomain> best;
+    int cols = std::max(1, (int)std::lround((double)rows * view.width / view.height));
+    double step = view.zoom / rows;
+    for (int y = 0; y < rows; y++) {
+        double ci = view.centerY + (y + 0.5 - rows / 2.0) * step;
+        for (int x = 0; x < cols; x++) {
+            double cr = view.centerX + (x + 0.5 - cols / 2.0) * step;
+            double norm;
+            int period = atomPeriod(cr, ci, minPeriod, maxPeriod, norm);
+            if (period == 0) continue;
+            AtomDomain &domain = best[period];
+            if (domain.period == 0 || norm < domain.norm) {
+                domain.period = period;
+                domain.re = cr;
+                domain.im = ci;
+                domain.norm = norm;
+            }
+        }
+    }
+    std::vector<AtomDomain> domains;
+    for (const auto &entry : best) domains.push_back(entry.second);
+    return domains;
+}
+
+bool inView(const View &view, double re, double im) {
+    double scale = view.zoom / view.height;
+    return std::fabs(re - view.centerX) <= view.width / 2.0 * scale && std::fabs(im - view.centerY) <= view.zoom / 2;
+}
+
+bool refineNucleus(double re, double im, int period, int bits, int digits, Nucleus &out) {
+    out = Nucleus();
+    out.period = period;
+    mp_bitcnt_t precision = std::max(bits, 64);
+    mpf_class cr(re, precision), ci(im, precision), size(0, precision);
+    double log2Size = 0;
+    while (true) {
+        // Шаг меньше 2^-(bits - 32): дальше Ньютон упрётся в округление
+        mpf_class eps2(1, precision);
+        mpf_div_2exp(eps2.get_mpf_t(), eps2.get_mpf_t(), 2 * (precision - 32));
+        out.converged = false;
+        for (int step = 0; step < MAX_NEWTON_STEPS && !out.converged; step++) {
+            mpf_class delta2 = newtonStep(cr, ci, period, precision);
+            out.steps++;
+            if (delta2 < 0) break;
+            out.converged = delta2 < eps2;
+        }
+        if (out.converged) period = out.period = primitivePeriod(cr, ci, period, precision);
+        size.set_prec(precision);
+        atomSize(cr, ci, period, precision, size, log2Size, out.angle);
+        // Точности должно хватать на ядро внутри миниброта размера size
+        mp_bitcnt_t need = (mp_bitcnt_t)std::ceil(std::max(0.0, -log2Size)) + GUARD_BITS;
+        if (!out.converged || need <= precision) break;
+        precision = (need + 63) / 64 * 64;
+        cr.set_prec(precision);
+        ci.set_prec(precision);
+    }
+    out.bits = (int)precision;
+    int places = digits > 0 ? digits : (int)std::ceil(std::max(0.0, -log2Size) * std::log10(2.0)) + 10;
+    // Значимых знаков не больше, чем даёт точность
+    places = std::min(places, (int)(precision * std::log10(2.0)));
+    out.re = fixedString(cr, places);
+    out.im = fixedString(ci, places);
+    // get_d отбрасывает хвост, а не округляет
+    out.centerX = std::strtod(fixedString(cr, DOUBLE_PLACES).c_str(), nullptr);
+    out.centerY = std::strtod(fixedString(ci, DOUBLE_PLACES).c_str(), nullptr);
+    out.size = scientificString(size, 3);
+    out.sizeValue = log2Size > -1020 ? std::exp2(log2Size) : 0;
+    return out.converged;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "view.h"
+#include <string>
+#include <vector>
+
+// --- Поиск минибротов: атомный домен в виде и его ядро ---
+// Атомный домен периода p — точки c, у которых |z_p| меньше всех |z_k|,
+// k < p (для точки — номер итерации с наименьшим |z|). Домен окружает
+// миниброт того же периода, и чем меньше период, тем крупнее миниброт.
+// Ядро миниброта (центр кардиоиды, где z_p = 0) уточняется методом Ньютона
+// из точки домена в многоразрядной арифметике (GMP): глубокие миниброты
+// меньше шага double, а точное ядро — готовая опорная точка для возмущений.
+// Домен бывает гораздо шире своего миниброта, поэтому домены в виде
+// перебираются по возрастанию периода, пока ядро не окажется в кадре.
+
+// Домен на сетке точек вида (в double)
+struct AtomDomain {
+    int period = 0;    // 0 — не найден
+    double re = 0;     // точка сетки с наименьшим |z_period|
+    double im = 0;
+    double norm = 0;   // |z_period|^2 в ней
+};
+
+// Домены на сетке rows строк (столбцов — по пропорциям вида) с периодами
+// из [minPeriod, maxPeriod]: по одному на период (точка, ближайшая к ядру),
+// по возрастанию периода
+std::vector<AtomDomain> findAtomDomains(const View &view, int rows, int minPeriod, int maxPeriod);
+
+// Лежит ли точка в кадре вида
+bool inView(const View &view, double re, double im);
+
+// Ядро миниброта и оценка его размера
+struct Nucleus {
+    int period = 0;
+    std::string re, im;        // центр в десятичной записи, digits знаков
+    double centerX = 0;        // он же, округлённый до double
+    double centerY = 0;
+    std::string size;          // размер (примерно ширина кардиоиды), 3 знака
+    double sizeValue = 0;      // он же в double (0, если меньше DBL_MIN)
+    double angle = 0;          // поворот миниброта относительно множества, рад
+    int bits = 0;              // точность последнего уточнения
+    int steps = 0;             // шагов Ньютона всего
+    bool converged = false;
+};
+
+// Ньютон для z_period(c) = 0 из (re, im) с точностью не меньше bits бит;
+// точность растёт, пока её не хватает на размер миниброта. digits — знаков
+// в re/im (0 — сколько значимо при найденном размере). Если ядро оказалось
+// ядром меньшего периода (делителя period), out.period — этот период.
+// false, если метод не сошёлся (out всё равно заполнен последним
+// приближением).
+bool refineNucleus(double re, double im, int period, int bits, int digits, Nucleus &out);
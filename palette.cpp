@@ -0,0 +1,143 @@
+#include "palette.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+// hsv2rgb из ядра, по компонентам
+float hsvChannel(float h, float offset, float s, float v) {
+    float k = h + offset;
+    float p = std::fabs((k - std::floor(k)) * 6.0f - 3.0f);
+    float c = std::min(std::max(p - 1.0f, 0.0f), 1.0f);
+    return v * (1.0f + (c - 1.0f) * s);
+}
+
+// Опорные точки градиента COLOR_SMOOTH (доля периода и цвет); после
+// последней — снова первая
+struct GradientStop {
+    float position;
+    float r, g, b;
+};
+const GradientStop GRADIENT[] = {
+    {0.0f, 0, 7, 100},    {0.16f, 32, 107, 203}, {0.42f, 237, 255, 255},
+    {0.6425f, 255, 170, 0}, {0.8575f, 0, 2, 0},
+};
+const int GRADIENT_STOPS = sizeof(GRADIENT) / sizeof(GRADIENT[0]);
+
+std::vector<Rgb> buildSmoothPalette() {
+    std::vector<Rgb> palette(PALETTE_SIZE);
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        float t = (float)i / PALETTE_SIZE;
+        int k = GRADIENT_STOPS - 1;
+        while (GRADIENT[k].position > t) k--;
+        const GradientStop &a = GRADIENT[k];
+        const GradientStop &b = GRADIENT[(k + 1) % GRADIENT_STOPS];
+        float end = k + 1 < GRADIENT_STOPS ? b.position : 1.0f;
+        float f = (t - a.position) / (end - a.position);
+        f = f * f * (3 - 2 * f);  // smoothstep: без изломов на опорных точках
+        palette[i] = {(uint8_t)(a.r + (b.r - a.r) * f + 0.5f), (uint8_t)(a.g + (b.g - a.g) * f + 0.5f),
+                      (uint8_t)(a.b + (b.b - a.b) * f + 0.5f)};
+    }
+    return palette;
+}
+
+}  // namespace
+
+const std::vector<Rgb> &smoothPalette() {
+    static const std::vector<Rgb> palette = buildSmoothPalette();
+    return palette;
+}
+
+Rgb smoothColor(float smooth, int maxIter) {
+    if (smooth >= maxIter) return {0, 0, 0};
+    // Как в ядре: float-умножение, fmax (отрицательное и NaN дают 0), потом маска
+    uint32_t index = (uint32_t)std::fmax(smooth * (PALETTE_SIZE / PALETTE_PERIOD), 0.0f);
+    return smoothPalette()[index & (PALETTE_SIZE - 1)];
+}
+
+std::string paletteKernelSource() {
+    std::ostringstream source;
+    source << "#define PALETTE_SIZE " << PALETTE_SIZE << "\n#define PALETTE_SCALE "
+           << std::fixed << PALETTE_SIZE / PALETTE_PERIOD << "f\n__constant uchar4 PALETTE[PALETTE_SIZE] = {";
+    for (const Rgb &c : smoothPalette())
+        source << "(uchar4)(" << (int)c.r << ',' << (int)c.g << ',' << (int)c.b << ",255),";
+    source << "};\n";
+    return source.str();
+}
+
+Rgb colorize(uint32_t iter, int maxIter, ColorMode mode) {
+    if (mode == COLOR_SMOOTH) return smoothColor((float)iter, maxIter);
+    float t = (float)iter / maxIter;
+    if (mode == COLOR_HSV) {
+        if ((int)iter == maxIter) return {0, 0, 0};
+        float h = t * 6.0f + 0.1f;
+        return {(uint8_t)(hsvChannel(h, 1.0f, 0.8f, 1.0f) * 255), (uint8_t)(hsvChannel(h, 2.0f / 3.0f, 0.8f, 1.0f) * 255),
+                (uint8_t)(hsvChannel(h, 1.0f / 3.0f, 0.8f, 1.0f) * 255)};
+    }
+    return {(uint8_t)(9 * (1 - t) * t * t * t * 255), (uint8_t)(15 * (1 - t) * (1 - t) * t * t * 255),
+            (uint8_t)(8.5 * (1 - t) * (1 - t) * (1 - t) * t * 255)};
+}
+
+void colorizeRow(const uint32_t *iter, int width, int maxIter, ColorMode mode, uint8_t *rgb) {
+    for (int x = 0; x < width; x++, rgb += 3) {
+        Rgb c = colorize(iter[x], maxIter, mode);
+        rgb[0] = c.r;
+        rgb[1] = c.g;
+        rgb[2] = c.b;
+    }
+}
+
+void colorizeRow(const float *smooth, int width, int maxIter, ColorMode mode, uint8_t *rgb) {
+    for (int x = 0; x < width; x++, rgb += 3) {
+        Rgb c = mode == COLOR_SMOOTH ? smoothColor(smooth[x], maxIter)
+                                     : colorize((uint32_t)std::max(smooth[x], 0.0f), maxIter, mode);
+        rgb[0] = c.r;
+        rgb[1] = c.g;
+        rgb[2] = c.b;
+    }
+}
+
+void distanceRow(const float *distance, int width, uint8_t *rgb) {
+    for (int x = 0; x < width; x++, rgb += 3) {
+        // Насыщение на двух пикселях от границы; корень растягивает ближний край
+        float t = std::min(std::max(distance[x] * 0.5f, 0.0f), 1.0f);
+        uint8_t v = (uint8_t)(std::sqrt(t) * 255 + 0.5f);
+        rgb[0] = rgb[1] = rgb[2] = v;
+    }
+}
+
+PaletteLut::PaletteLut(int maxIter, ColorMode mode) : lut_(maxIter + 1), mode_(mode) {
+    for (int i = 0; i <= maxIter; i++) lut_[i] = colorize(i, maxIter, mode);
+}
+
+PaletteLut::PaletteLut(std::vector<Rgb> lut) : lut_(std::move(lut)), mode_(COLOR_POLY) {}
+
+void PaletteLut::row(const uint32_t *iter, int width, uint8_t *rgb) const {
+    uint32_t last = lut_.size() - 1;
+    for (int x = 0; x < width; x++, rgb += 3) {
+        const Rgb &c = lut_[std::min(iter[x], last)];
+        rgb[0] = c.r;
+        rgb[1] = c.g;
+        rgb[2] = c.b;
+    }
+}
+
+void PaletteLut::row(const float *smooth, int width, uint8_t *rgb) const {
+    if (mode_ == COLOR_SMOOTH) {
+        colorizeRow(smooth, width, (int)lut_.size() - 1, mode_, rgb);
+        return;
+    }
+    float last = (float)(lut_.size() - 1);
+    for (int x = 0; x < width; x++, rgb += 3) {
+        float s = std::min(std::max(smooth[x], 0.0f), last);
+        size_t i = (size_t)s;
+        float f = s - i;
+        const Rgb &a = lut_[i];
+        const Rgb &b = lut_[std::min(i + 1, lut_.size() - 1)];
+        rgb[0] = (uint8_t)(a.r + (b.r - a.r) * f + 0.5f);
+        rgb[1] = (uint8_t)(a.g + (b.g - a.g) * f + 0.5f);
+        rgb[2] = (uint8_t)(a.b + (b.b - a.b) * f + 0.5f);
+    }
+}
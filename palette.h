@@ -0,0 +1,61 @@
+#pragma once
+#include "cl_kernel.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --- Палитры на CPU ---
+// Те же формулы, что colorize() в ядре (cl_kernel.cpp): кадр, раскрашенный
+// на CPU из буфера итераций, совпадает с окном.
+struct Rgb {
+    uint8_t r, g, b;
+};
+static_assert(sizeof(Rgb) == 3, "Rgb arrays are used as packed RGB rows");
+
+Rgb colorize(uint32_t iter, int maxIter, ColorMode mode);
+
+// Строка итераций в RGB (3 байта на пиксель)
+void colorizeRow(const uint32_t *iter, int width, int maxIter, ColorMode mode, uint8_t *rgb);
+// То же по дробным итерациям (IterationBuffer::smooth): COLOR_SMOOTH без
+// полос, остальные палитры — по целой части
+void colorizeRow(const float *smooth, int width, int maxIter, ColorMode mode, uint8_t *rgb);
+
+// --- Циклическая палитра для дробных итераций (COLOR_SMOOTH) ---
+// Градиент из PALETTE_SIZE цветов повторяется каждые PALETTE_PERIOD
+// итераций: длина таблицы не зависит от maxIter, а цвет пикселя — одно
+// чтение из неё. В ядро таблица попадает __constant массивом
+// (paletteKernelSource), так что окно и CPU красят одинаково.
+const int PALETTE_SIZE = 1024;  // степень двойки: индекс берётся по маске
+const float PALETTE_PERIOD = 64;
+
+const std::vector<Rgb> &smoothPalette();
+// Внутренность множества (smooth >= maxIter) — чёрная
+Rgb smoothColor(float smooth, int maxIter);
+// Определения PALETTE_SIZE, PALETTE_SCALE и массива PALETTE для начала
+// программы OpenCL
+std::string paletteKernelSource();
+
+// --- Раскраска по оценке расстояния (IterationBuffer::distance) ---
+// Серая шкала: граница множества — чёрная линия толщиной около пикселя,
+// дальше от неё светлее. Нити, которые тоньше пикселя и теряются в
+// раскраске по итерациям, остаются видны.
+void distanceRow(const float *distance, int width, uint8_t *rgb);
+
+// --- Палитра таблицей ---
+// colorize() для всех iter от 0 до maxIter: раскраска одним чтением из
+// таблицы, без формул на пиксель (recolor идёт со скоростью памяти).
+// Для COLOR_SMOOTH дробные итерации берутся прямо из smoothPalette().
+class PaletteLut {
+public:
+    PaletteLut(int maxIter, ColorMode mode);
+    // Готовая таблица на maxIter + 1 цветов (например, IterHistogram::palette)
+    explicit PaletteLut(std::vector<Rgb> lut);
+
+    void row(const uint32_t *iter, int width, uint8_t *rgb) const;
+    // Дробное число итераций: линейно между соседними записями таблицы
+    void row(const float *smooth, int width, uint8_t *rgb) const;
+
+private:
+    std::vector<Rgb> lut_;
+    ColorMode mode_;
+};
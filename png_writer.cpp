@@ -0,0 +1,221 @@
+#include "png_writer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Сжатые данные уходят чанками IDAT такого размера
+const size_t IDAT_SIZE = 1 << 20;
+// Окно deflate: столько хвоста предыдущей полосы служит словарём
+const size_t WINDOW = 32768;
+
+void putBe32(uint8_t *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+}  // namespace
+
+PngWriter::~PngWriter() {
+    stopWorkers();
+}
+
+bool PngWriter::open(const std::string &path, int width, int height, int level, int threads) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    return file_ && open(file_, width, height, level, threads);
+}
+
+bool PngWriter::open(std::ostream &out, int width, int height, int level, int threads) {
+    if (width <= 0 || height <= 0) return false;
+    out_ = &out;
+    width_ = width;
+    height_ = height;
+    level_ = level;
+    rowsWritten_ = 0;
+    adler_ = adler32(0, nullptr, 0);
+    idat_.clear();
+    idat_.reserve(IDAT_SIZE);
+    current_ = std::make_shared<Stripe>();
+    ok_ = true;
+
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    stopping_ = false;
+    // С одним потоком полосы сжимаются прямо в writeRows()
+    for (int i = 0; i < threads && threads > 1; i++)
+        workers_.emplace_back([this] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true) {
+                changed_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                std::shared_ptr<Stripe> stripe = queue_.front();
+                queue_.pop_front();
+                lock.unlock();
+                compress(*stripe);
+                lock.lock();
+                stripe->done = true;
+                changed_.notify_all();
+            }
+        });
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out_->write((const char *)SIGNATURE, sizeof(SIGNATURE));
+    uint8_t header[13];
+    putBe32(header, width);
+    putBe32(header + 4, height);
+    header[8] = 8;   // бит на канал
+    header[9] = 2;   // RGB
+    header[10] = 0;  // deflate
+    header[11] = 0;  // стандартные фильтры
+    header[12] = 0;  // без чересстрочности
+    ok_ = writeChunk("IHDR", header, sizeof(header));
+
+    // Заголовок zlib: окно 32 КБ, FLEVEL по уровню (только для справки),
+    // FCHECK дополняет до кратного 31
+    int flevel = level == Z_DEFAULT_COMPRESSION || level == 6 ? 2 : level <= 1 ? 0 : level < 6 ? 1 : 3;
+    uint8_t zlibHeader[2] = {0x78, (uint8_t)(flevel << 6)};
+    zlibHeader[1] += 31 - (zlibHeader[0] * 256 + zlibHeader[1]) % 31;
+    return ok_ && writeData(zlibHeader, 2, false);
+}
+
+bool PngWriter::writeRows(const uint8_t *rgb, int rows) {
+    if (!ok_ || rowsWritten_ + rows > height_) return false;
+    size_t stride = (size_t)width_ * 3;
+    for (int y = 0; y < rows; y++, rgb += stride) {
+        // Фильтр Sub: разность с пикселем слева, плавные градиенты
+        // сжимаются заметно лучше, а строки остаются независимыми
+        std::vector<uint8_t> &input = current_->input;
+        size_t base = input.size();
+        input.resize(base + stride + 1);
+        uint8_t *row = &input[base];
+        row[0] = 1;
+        std::memcpy(row + 1, rgb, 3);
+        for (size_t i = 3; i < stride; i++) row[i + 1] = (uint8_t)(rgb[i] - rgb[i - 3]);
+        if (input.size() >= STRIPE_BYTES) submit();
+    }
+    rowsWritten_ += rows;
+    return ok_;
+}
+
+bool PngWriter::close() {
+    if (!out_) return false;
+    if (!current_->input.empty()) submit();
+    while (!inFlight_.empty()) writeFront();
+    stopWorkers();
+    // Пустой последний блок (фиксированные коды, только конец блока)
+    // закрывает поток deflate, дальше adler32 всех несжатых данных
+    uint8_t tail[6] = {0x03, 0x00};
+    putBe32(tail + 2, (uint32_t)adler_);
+    bool ok = ok_ && rowsWritten_ == height_ && writeData(tail, sizeof(tail), true) && writeChunk("IEND", nullptr, 0);
+    out_->flush();
+    ok = ok && !out_->fail();
+    if (file_.is_open()) file_.close();
+    out_ = nullptr;
+    ok_ = false;
+    return ok;
+}
+
+void PngWriter::compress(Stripe &stripe) const {
+    stripe.inputSize = stripe.input.size();
+    stripe.adler = adler32(adler32(0, nullptr, 0), stripe.input.data(), (uInt)stripe.input.size());
+    z_stream zs = {};
+    if (deflateInit2(&zs, level_, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        stripe.failed = true;
+        return;
+    }
+    if (!stripe.dictionary.empty())
+        deflateSetDictionary(&zs, stripe.dictionary.data(), (uInt)stripe.dictionary.size());
+    // Запас на маркер Z_SYNC_FLUSH сверх deflateBound
+    stripe.output.resize(deflateBound(&zs, stripe.input.size()) + 16);
+    zs.next_in = stripe.input.data();
+    zs.avail_in = (uInt)stripe.input.size();
+    zs.next_out = stripe.output.data();
+    zs.avail_out = (uInt)stripe.output.size();
+    // Z_SYNC_FLUSH: блоки не последние и кончаются на границе байта, так что
+    // следующую полосу можно приписать сразу за ними
+    int status = deflate(&zs, Z_SYNC_FLUSH);
+    stripe.failed = status != Z_OK || zs.avail_in != 0 || zs.avail_out == 0;
+    stripe.output.resize(stripe.output.size() - zs.avail_out);
+    deflateEnd(&zs);
+    // Вход больше не нужен (кроме словаря, который уже скопирован)
+    std::vector<uint8_t>().swap(stripe.input);
+}
+
+void PngWriter::submit() {
+    std::shared_ptr<Stripe> stripe = current_;
+    current_ = std::make_shared<Stripe>();
+    // Хвост этой полосы — словарь следующей
+    size_t tail = std::min(WINDOW, stripe->input.size());
+    current_->dictionary.assign(stripe->input.end() - tail, stripe->input.end());
+    inFlight_.push_back(stripe);
+
+    if (workers_.empty()) {
+        compress(*stripe);
+        stripe->done = true;
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(stripe);
+        changed_.notify_one();
+    }
+    // Не больше двух полос на поток: память ограничена, а потоки не простаивают
+    size_t limit = std::max<size_t>(1, workers_.size() * 2);
+    while (inFlight_.size() > limit) writeFront();
+}
+
+bool PngWriter::writeFront() {
+    std::shared_ptr<Stripe> stripe = inFlight_.front();
+    inFlight_.pop_front();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return stripe->done; });
+    }
+    if (stripe->failed) ok_ = false;
+    if (!ok_) return false;
+    adler_ = adler32_combine(adler_, stripe->adler, (z_off_t)stripe->inputSize);
+    ok_ = writeData(stripe->output.data(), stripe->output.size(), false);
+    return ok_;
+}
+
+bool PngWriter::writeData(const uint8_t *data, size_t size, bool flush) {
+    while (size > 0) {
+        size_t take = std::min(size, IDAT_SIZE - idat_.size());
+        idat_.insert(idat_.end(), data, data + take);
+        data += take;
+        size -= take;
+        if (idat_.size() == IDAT_SIZE) {
+            if (!writeChunk("IDAT", idat_.data(), idat_.size())) return false;
+            idat_.clear();
+        }
+    }
+    if (flush && !idat_.empty()) {
+        if (!writeChunk("IDAT", idat_.data(), idat_.size())) return false;
+        idat_.clear();
+    }
+    return true;
+}
+
+bool PngWriter::writeChunk(const char *type, const uint8_t *data, size_t size) {
+    uint8_t length[4], crc[4];
+    putBe32(length, (uint32_t)size);
+    uLong sum = crc32(0, (const Bytef *)type, 4);
+    if (size > 0) sum = crc32(sum, data, (uInt)size);
+    putBe32(crc, (uint32_t)sum);
+    out_->write((const char *)length, 4);
+    out_->write(type, 4);
+    if (size > 0) out_->write((const char *)data, size);
+    out_->write((const char *)crc, 4);
+    return (bool)*out_;
+}
+
+void PngWriter::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        changed_.notify_all();
+    }
+    for (std::thread &worker : workers_) worker.join();
+    workers_.clear();
+    queue_.clear();
+    inFlight_.clear();
+}
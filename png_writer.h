@@ -0,0 +1,81 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+// --- Потоковая запись PNG (RGB, 8 бит на канал) ---
+// Строки подаются сверху вниз порциями и сразу уходят в сжатие: в памяти
+// только несколько полос по STRIPE_BYTES, так что размер картинки ограничен
+// лишь самим PNG (до 2^31-1 пикселей по стороне).
+// Сжатие параллельное, как в pigz: отфильтрованные строки режутся на полосы,
+// каждую полосу потоки сжимают в независимые блоки deflate (словарь — хвост
+// предыдущей полосы, конец — Z_SYNC_FLUSH по границе байта), и блоки
+// склеиваются в один поток zlib с общей adler32. Результат не зависит от
+// числа потоков.
+class PngWriter {
+public:
+    // Вход одной полосы: больше — лучше параллелится, меньше — меньше памяти
+    static const size_t STRIPE_BYTES = 1 << 20;
+
+    PngWriter() = default;
+    ~PngWriter();
+    PngWriter(const PngWriter &) = delete;
+    PngWriter &operator=(const PngWriter &) = delete;
+
+    // level — уровень zlib (0..9, Z_DEFAULT_COMPRESSION), threads = 0 — по
+    // числу ядер
+    bool open(const std::string &path, int width, int height, int level = Z_DEFAULT_COMPRESSION, int threads = 0);
+    // То же в уже открытый поток (например, в память для бенчмарка)
+    bool open(std::ostream &out, int width, int height, int level = Z_DEFAULT_COMPRESSION, int threads = 0);
+    // rows строк по width*3 байт подряд
+    bool writeRows(const uint8_t *rgb, int rows);
+    // Дожать полосы, закрыть поток deflate и дописать IEND; false, если строк
+    // меньше height или запись не удалась
+    bool close();
+
+private:
+    struct Stripe {
+        std::vector<uint8_t> input;       // отфильтрованные строки
+        std::vector<uint8_t> dictionary;  // последние 32 КБ предыдущей полосы
+        std::vector<uint8_t> output;      // сырой deflate без заголовка
+        size_t inputSize = 0;
+        uLong adler = 0;
+        bool done = false;
+        bool failed = false;
+    };
+
+    void compress(Stripe &stripe) const;
+    void submit();
+    // Дождаться самой старой полосы и записать её
+    bool writeFront();
+    bool writeData(const uint8_t *data, size_t size, bool flush);
+    bool writeChunk(const char *type, const uint8_t *data, size_t size);
+    void stopWorkers();
+
+    std::ofstream file_;
+    std::ostream *out_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    int level_ = Z_DEFAULT_COMPRESSION;
+    int rowsWritten_ = 0;
+    bool ok_ = false;
+    uLong adler_ = 1;
+    std::vector<uint8_t> idat_;  // накопление сжатых данных до размера IDAT
+
+    std::shared_ptr<Stripe> current_;
+    // Полосы в порядке записи; ещё не сжатые стоят и в queue_
+    std::deque<std::shared_ptr<Stripe>> inFlight_;
+    std::deque<std::shared_ptr<Stripe>> queue_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,359 @@
+// --- Постер: кадр любого размера полосами прямо в PNG ---
+// Использование: poster [--size WxH] [--view имя] [--center X,Y] [--zoom Z]
+//                       [--max-iter N] [--engine подстрока] [--color poly|hsv|smooth]
+//                       [--band-mb N] [--level 0..9] [--compress none|zlib]
+//                       [--out файл.png|файл.mraw] [--distance] [--formula формула]
+//                       [--cache-mb N] [--tile-store каталог]
+// Кадр целиком в память не помещается (100k x 100k — 40 ГБ одних итераций),
+// поэтому он считается горизонтальными полосами по --band-mb мегабайт.
+// Вычислитель считает следующую полосу, пока поток записи раскрашивает,
+// сжимает и пишет предыдущую; в памяти не больше BAND_BUFFERS полос.
+// Сжатие параллельное (PngWriter), --level — уровень zlib.
+// Файл .mraw вместо PNG сохраняет итерации и дробные итерации без раскраски
+// (raw_format.h) — раскрасить потом можно утилитой recolor.
+// --distance считает и оценку расстояния до множества: в .mraw она идёт
+// плоскостью RAW_DISTANCE, PNG раскрашивается по ней (distanceRow) вместо
+// --color.
+// --formula — формула итераций (formula.h): mandelbrot (по умолчанию),
+// julia:X,Y, multibrot:N или burning-ship; --distance — только с mandelbrot.
+// --cache-mb — считать через кэш плиток (CachedEngine) на N МБ: повторный
+// постер той же области берёт готовые плитки. Кэш хранит только итерации,
+// поэтому не сочетается с --color smooth, .mraw и --distance.
+// --tile-store — плитки кэша дополнительно сохраняются на диск (TileStore)
+// и переживают запуск; только вместе с --cache-mb.
+#include "cached_engine.h"
+#include "engine.h"
+#include "palette.h"
+#include "png_writer.h"
+#include "raw_format.h"
+#include "tile_store.h"
+#include "trace.h"
+#include "views.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Одна полоса считается, одна ждёт в очереди, одна пишется
+const int BAND_BUFFERS = 3;
+
+struct Options {
+    int width = 8000;
+    int height = 6000;
+    View view;
+    int maxIter = 0;  // 0 — как у вида
+    std::string engineFilter;
+    ColorMode colorMode = COLOR_POLY;
+    size_t bandMb = 64;
+    int level = Z_DEFAULT_COMPRESSION;
+    RawCompression compression = RAW_ZLIB;
+    std::string out = "poster.png";
+    bool distance = false;
+    Formula formula;
+    size_t cacheMb = 0;  // 0 — без кэша плиток
+    std::string tileStore;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(arg, "--distance") == 0) {
+            options.distance = true;
+            continue;
+        }
+        if (!value) return false;
+        if (std::strcmp(arg, "--size") == 0) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2) return false;
+        } else if (std::strcmp(arg, "--view") == 0) {
+            const NamedView *named = findView(value);
+            if (!named) return false;
+            options.view = named->view;
+        } else if (std::strcmp(arg, "--center") == 0) {
+            if (std::sscanf(value, "%lf,%lf", &options.view.centerX, &options.view.centerY) != 2) return false;
+        } else if (std::strcmp(arg, "--zoom") == 0) {
+            options.view.zoom = std::atof(value);
+        } else if (std::strcmp(arg, "--max-iter") == 0) {
+            options.maxIter = std::atoi(value);
+        } else if (std::strcmp(arg, "--engine") == 0) {
+            options.engineFilter = value;
+        } else if (std::strcmp(arg, "--color") == 0) {
+            if (std::strcmp(value, "poly") == 0) options.colorMode = COLOR_POLY;
+            else if (std::strcmp(value, "hsv") == 0) options.colorMode = COLOR_HSV;
+            else if (std::strcmp(value, "smooth") == 0) options.colorMode = COLOR_SMOOTH;
+            else return false;
+        } else if (std::strcmp(arg, "--band-mb") == 0) {
+            options.bandMb = std::max(1ul, std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--level") == 0) {
+            options.level = std::atoi(value);
+            if (options.level < 0 || options.level > 9) return false;
+        } else if (std::strcmp(arg, "--compress") == 0) {
+            if (std::strcmp(value, "none") == 0) options.compression = RAW_NONE;
+            else if (std::strcmp(value, "zlib") == 0) options.compression = RAW_ZLIB;
+            else return false;
+        } else if (std::strcmp(arg, "--out") == 0) {
+            options.out = value;
+        } else if (std::strcmp(arg, "--formula") == 0) {
+            if (!parseFormula(value, options.formula)) return false;
+        } else if (std::strcmp(arg, "--cache-mb") == 0) {
+            options.cacheMb = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--tile-store") == 0) {
+            options.tileStore = value;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    if (options.maxIter > 0) options.view.maxIter = options.maxIter;
+    options.view.width = options.width;
+    options.view.height = options.height;
+    if (options.distance && options.formula.kind != FORMULA_MANDELBROT) return false;
+    bool rawOutput = options.out.size() > 5 && options.out.compare(options.out.size() - 5, 5, ".mraw") == 0;
+    if (!options.tileStore.empty() && options.cacheMb == 0) return false;
+    if (options.cacheMb > 0 && (options.distance || rawOutput || options.colorMode == COLOR_SMOOTH)) return false;
+    return options.width > 0 && options.height > 0 && options.view.zoom > 0;
+}
+
+struct Band {
+    int top = 0;   // первая строка полосы в PNG (сверху)
+    int rows = 0;  // сколько строк полосы попадает в кадр
+    IterationBuffer iter;
+};
+
+// --- Очередь полос между вычислителем и записью ---
+class BandQueue {
+public:
+    explicit BandQueue(int buffers) : bands_(buffers) {
+        for (Band &band : bands_) free_.push_back(&band);
+    }
+
+    // Свободный буфер (ждёт, пока запись вернёт); nullptr после stop()
+    Band *acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return stopped_ || !free_.empty(); });
+        if (stopped_) return nullptr;
+        Band *band = free_.front();
+        free_.pop_front();
+        return band;
+    }
+    void push(Band *band) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(band);
+        changed_.notify_all();
+    }
+    // Следующая посчитанная полоса; nullptr, когда их больше не будет
+    Band *pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return stopped_ || finished_ || !ready_.empty(); });
+        if (stopped_ || ready_.empty()) return nullptr;
+        Band *band = ready_.front();
+        ready_.pop_front();
+        return band;
+    }
+    void release(Band *band) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(band);
+        changed_.notify_all();
+    }
+    // Больше полос не будет (очередь дочитывается)
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        changed_.notify_all();
+    }
+    // Ошибка: обе стороны выходят сразу
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+        changed_.notify_all();
+    }
+
+private:
+    std::vector<Band> bands_;
+    std::deque<Band *> free_, ready_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool finished_ = false;
+    bool stopped_ = false;
+};
+
+// Вид полосы из bandRows строк, начиная со строки top (сверху) кадра view:
+// тот же шаг пикселя, центр сдвинут по y. Последняя полоса может выходить
+// за низ кадра — лишние строки считаются и отбрасываются, зато все полосы
+// одного размера и вычислитель не перестраивается под последнюю.
+// Координаты пикселей совпадают с цельным кадром с точностью до последнего
+// бита double, так что на хаотичных границах редкие пиксели могут отличаться.
+View bandView(const View &view, int top, int bandRows) {
+    double step = view.zoom / view.height;
+    int y0 = view.height - top - bandRows;  // нижняя строка полосы в координатах вида
+    View band = view;
+    band.height = bandRows;
+    band.zoom = step * bandRows;
+    band.centerY = view.centerY + (y0 + bandRows / 2.0 - view.height / 2.0) * step;
+    return band;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: poster [--size WxH] [--view name] [--center X,Y] [--zoom Z] [--max-iter N]"
+                     " [--engine substr] [--color poly|hsv|smooth] [--band-mb N] [--level 0..9] [--compress none|zlib]"
+                     " [--out file.png|file.mraw] [--distance]"
+                     " [--formula mandelbrot|julia:X,Y|multibrot:N|burning-ship] [--cache-mb N]"
+                     " [--tile-store dir]"
+                  << std::endl;
+        return 2;
+    }
+    const View &view = options.view;
+
+    // Глубже FLOAT_SCALE_LIMIT float-вычислители не различают пиксели
+    bool needDouble = view.zoom / view.height < FLOAT_SCALE_LIMIT;
+    std::unique_ptr<Engine> engine;
+    for (auto &candidate : createEngines()) {
+        if (candidate->name().find(options.engineFilter) == std::string::npos) continue;
+        if (needDouble && candidate->precision() != PRECISION_DOUBLE) continue;
+        engine = std::move(candidate);
+        break;
+    }
+    if (!engine) {
+        std::cerr << "no engine matches '" << options.engineFilter << "'" << std::endl;
+        return 1;
+    }
+    std::shared_ptr<TileStore> store;
+    if (!options.tileStore.empty()) {
+        store = std::make_shared<TileStore>(options.tileStore);
+        if (!store->ready()) {
+            std::cerr << "cannot open tile store " << options.tileStore << std::endl;
+            return 1;
+        }
+    }
+    std::shared_ptr<TileCache> cache;
+    if (options.cacheMb > 0) {
+        cache = std::make_shared<TileCache>(options.cacheMb << 20);
+        cache->setStore(store);
+        engine = std::make_unique<CachedEngine>(std::move(engine), cache);
+    }
+
+    size_t rowBytes = (size_t)view.width * sizeof(uint32_t);
+    int bandRows = (int)std::clamp<size_t>((options.bandMb << 20) / rowBytes, 1, view.height);
+    int bands = (view.height + bandRows - 1) / bandRows;
+    std::fprintf(stderr, "%s: %dx%d in %d bands of %d rows (%.1f MB each)\n", engine->name().c_str(), view.width,
+                 view.height, bands, bandRows, bandRows * rowBytes / 1048576.0);
+
+    bool rawOutput = options.out.size() > 5 && options.out.compare(options.out.size() - 5, 5, ".mraw") == 0;
+    PngWriter png;
+    RawWriter raw;
+    bool opened;
+    // COLOR_SMOOTH красит по дробным итерациям, .mraw их сохраняет
+    engine->setSmooth(rawOutput || options.colorMode == COLOR_SMOOTH);
+    engine->setDistance(options.distance);
+    engine->setFormula(options.formula);
+    if (rawOutput) {
+        RawHeader header;
+        header.width = view.width;
+        header.height = view.height;
+        header.maxIter = view.maxIter;
+        header.planes = RAW_ITER | RAW_SMOOTH | (options.distance ? RAW_DISTANCE : 0);
+        header.compression = options.compression;
+        header.centerX = view.centerX;
+        header.centerY = view.centerY;
+        header.zoom = view.zoom;
+        opened = raw.open(options.out, header);
+    } else {
+        opened = png.open(options.out, view.width, view.height, options.level);
+    }
+    if (!opened) {
+        std::cerr << "cannot write " << options.out << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    BandQueue queue(BAND_BUFFERS);
+    bool writeOk = true;
+    double writeSeconds = 0;
+
+    // --- Поток записи: раскраска, сжатие, диск ---
+    std::thread writer([&] {
+        traceSetThreadName("poster writer");
+        std::vector<uint8_t> rgb((size_t)view.width * 3);
+        while (Band *band = queue.pop()) {
+            TraceSpan span("poster write band");
+            auto bandStart = std::chrono::steady_clock::now();
+            // Строки буфера идут снизу вверх, файлы — сверху вниз
+            for (int r = 0; r < band->rows && writeOk; r++) {
+                size_t offset = (size_t)(band->iter.height - 1 - r) * view.width;
+                const uint32_t *row = &band->iter.iter[offset];
+                if (rawOutput) {
+                    const float *smooth = band->iter.smooth.empty() ? nullptr : &band->iter.smooth[offset];
+                    const float *distance = band->iter.distance.empty() ? nullptr : &band->iter.distance[offset];
+                    writeOk = raw.writeRow(row, smooth, distance);
+                } else if (!band->iter.distance.empty()) {
+                    distanceRow(&band->iter.distance[offset], view.width, rgb.data());
+                    writeOk = png.writeRows(rgb.data(), 1);
+                } else if (!band->iter.smooth.empty()) {
+                    colorizeRow(&band->iter.smooth[offset], view.width, view.maxIter, options.colorMode, rgb.data());
+                    writeOk = png.writeRows(rgb.data(), 1);
+                } else {
+                    colorizeRow(row, view.width, view.maxIter, options.colorMode, rgb.data());
+                    writeOk = png.writeRows(rgb.data(), 1);
+                }
+            }
+            writeSeconds += secondsSince(bandStart);
+            queue.release(band);
+            if (!writeOk) queue.stop();
+        }
+    });
+
+    // --- Вычислитель: полосы сверху вниз ---
+    traceSetThreadName("poster render");
+    bool renderOk = true;
+    double renderSeconds = 0;
+    uint64_t iterations = 0;
+    for (int index = 0; index < bands && renderOk; index++) {
+        Band *band = queue.acquire();
+        if (!band) break;
+        band->top = index * bandRows;
+        band->rows = std::min(bandRows, view.height - band->top);
+        auto bandStart = std::chrono::steady_clock::now();
+        {
+            TraceSpan span("poster render band");
+            renderOk = engine->render(bandView(view, band->top, bandRows), band->iter);
+        }
+        renderSeconds += secondsSince(bandStart);
+        iterations += engine->stats().iterations;
+        if (!renderOk) {
+            std::cerr << "render failed on band " << index << std::endl;
+            queue.stop();
+            break;
+        }
+        queue.push(band);
+        std::fprintf(stderr, "\rband %d/%d", index + 1, bands);
+    }
+    queue.finish();
+    writer.join();
+    bool ok = renderOk && writeOk && (rawOutput ? raw.close() : png.close());
+
+    double total = secondsSince(start);
+    std::fprintf(stderr, "\n%s: %.1f s total, render %.1f s, write %.1f s, %.1f Mpix/s, %.3f Giter/s\n",
+                 ok ? options.out.c_str() : "FAILED", total, renderSeconds, writeSeconds,
+                 (double)view.width * view.height / (total * 1e6), iterations / (renderSeconds * 1e9));
+    if (cache) printTileCacheStats(*cache);
+    if (store) printTileStoreStats(*store);
+    return ok ? 0 : 1;
+}
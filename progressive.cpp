@@ -0,0 +1,31 @@
+#include "progressive.h"
+#include <algorithm>
+
+TileQueue::TileQueue(int width, int height) {
+    for (int y = 0; y < height; y += TILE)
+        for (int x = 0; x < width; x += TILE)
+            tiles_.push_back({x, y, std::min(x + TILE, width) - x, std::min(y + TILE, height) - y});
+    // Расстояние от центра плитки до центра кадра (в удвоенных пикселях)
+    auto distance = [&](const Tile &t) {
+        double dx = 2 * t.x + t.w - width;
+        double dy = 2 * t.y + t.h - height;
+        return dx * dx + dy * dy;
+    };
+    std::stable_sort(tiles_.begin(), tiles_.end(),
+                     [&](const Tile &a, const Tile &b) { return distance(a) < distance(b); });
+    next_ = tiles_.size();
+}
+
+void TileQueue::restart() {
+    next_ = 0;
+}
+
+bool TileQueue::next(int &x, int &y, int &w, int &h) {
+    if (done()) return false;
+    const Tile &tile = tiles_[next_++];
+    x = tile.x;
+    y = tile.y;
+    w = tile.w;
+    h = tile.h;
+    return true;
+}
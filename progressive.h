@@ -0,0 +1,57 @@
+#pragma once
+#include "view.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// --- Превью по прошлому кадру ---
+// Пиксели нового вида берутся из ближайших пикселей старого (за краем
+// старого кадра — крайние). При зуме и сдвиге это почти готовая картинка,
+// которую можно показать сразу, пока точные пиксели считаются.
+template <typename Pixel>
+void resampleView(const std::vector<Pixel> &src, const View &srcView, std::vector<Pixel> &dst, const View &dstView) {
+    dst.resize((size_t)dstView.width * dstView.height);
+    double srcScale = srcView.zoom / srcView.height;
+    double dstScale = dstView.zoom / dstView.height;
+    double ratio = dstScale / srcScale;
+    // Точка пикселя x нового вида попадает в точку ratio*x + offset старого
+    double offsetX = (dstView.centerX - srcView.centerX) / srcScale + srcView.width / 2.0 - ratio * dstView.width / 2.0;
+    double offsetY =
+        (dstView.centerY - srcView.centerY) / srcScale + srcView.height / 2.0 - ratio * dstView.height / 2.0;
+    // Ближайший пиксель с прижатием к краю (в double: при сильном отдалении
+    // координата не влезает в int)
+    auto nearest = [](double u, int size) { return (int)std::fmin(std::fmax(std::floor(u + 0.5), 0.0), size - 1.0); };
+    std::vector<int> columns(dstView.width);
+    for (int x = 0; x < dstView.width; x++) columns[x] = nearest(ratio * x + offsetX, srcView.width);
+    for (int y = 0; y < dstView.height; y++) {
+        int sy = nearest(ratio * y + offsetY, srcView.height);
+        const Pixel *srcRow = &src[(size_t)sy * srcView.width];
+        Pixel *dstRow = &dst[(size_t)y * dstView.width];
+        for (int x = 0; x < dstView.width; x++) dstRow[x] = srcRow[columns[x]];
+    }
+}
+
+// --- Очередь плиток кадра от центра к краям ---
+// Пока кадр не досчитан, на экране превью, в котором точные плитки
+// постепенно заменяют пересэмплированные — сначала в центре, куда смотрят
+// при зуме.
+class TileQueue {
+public:
+    static const int TILE = 128;
+
+    TileQueue(int width, int height);
+
+    // Все плитки снова в очереди
+    void restart();
+    bool done() const { return next_ >= tiles_.size(); }
+
+    // Следующая плитка [x, x + w) x [y, y + h); false, если кадр досчитан
+    bool next(int &x, int &y, int &w, int &h);
+
+private:
+    struct Tile {
+        int x, y, w, h;
+    };
+    std::vector<Tile> tiles_;  // уже отсортированы от центра
+    size_t next_ = 0;
+};
@@ -0,0 +1,167 @@
+#include "raw_format.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+
+const RawPlane PLANES[] = {RAW_ITER, RAW_SMOOTH, RAW_DISTANCE};
+const size_t VALUE_BYTES = 4;  // uint32 или float
+// Уровень zlib: данные итераций сжимаются хорошо и на быстром уровне
+const int ZLIB_LEVEL = 1;
+
+// Номер плоскости среди имеющихся в файле; -1, если её нет
+int planeSlot(uint32_t planes, RawPlane plane) {
+    if (!(planes & plane)) return -1;
+    int slot = 0;
+    for (RawPlane p : PLANES) {
+        if (p == plane) return slot;
+        if (planes & p) slot++;
+    }
+    return -1;
+}
+
+uint64_t tableBytes(const RawHeader &header) {
+    return (uint64_t)header.strips() * header.planeCount() * sizeof(RawStripEntry);
+}
+
+}  // namespace
+
+int RawHeader::planeCount() const {
+    int count = 0;
+    for (RawPlane plane : PLANES) count += (planes & plane) ? 1 : 0;
+    return count;
+}
+
+// --- RawWriter ---
+
+bool RawWriter::open(const std::string &path, const RawHeader &header) {
+    if (header.width == 0 || header.height == 0 || header.stripRows == 0 || !(header.planes & RAW_ITER)) return false;
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) return false;
+    header_ = header;
+    table_.assign((size_t)header_.strips() * header_.planeCount(), RawStripEntry{0, 0});
+    strip_.assign(header_.planeCount(), {});
+    for (auto &plane : strip_) plane.reserve((size_t)header_.stripRows * header_.width * VALUE_BYTES);
+    rows_ = 0;
+    rowsTotal_ = 0;
+    // Место под заголовок и таблицу; заполняются в close()
+    offset_ = sizeof(RawHeader) + tableBytes(header_);
+    std::vector<char> zeros(offset_);
+    file_.write(zeros.data(), zeros.size());
+    ok_ = (bool)file_;
+    return ok_;
+}
+
+bool RawWriter::writeRow(const uint32_t *iter, const float *smooth, const float *distance) {
+    if (!ok_ || rowsTotal_ >= (int)header_.height) return false;
+    const void *rows[] = {iter, smooth, distance};
+    size_t rowBytes = (size_t)header_.width * VALUE_BYTES;
+    int slot = 0;
+    for (int i = 0; i < 3; i++) {
+        if (!(header_.planes & PLANES[i])) continue;
+        std::vector<uint8_t> &plane = strip_[slot++];
+        size_t base = plane.size();
+        plane.resize(base + rowBytes);
+        if (rows[i]) std::memcpy(&plane[base], rows[i], rowBytes);
+        else std::memset(&plane[base], 0, rowBytes);
+    }
+    rows_++;
+    rowsTotal_++;
+    if (rows_ == (int)header_.stripRows) return flushStrip();
+    return true;
+}
+
+bool RawWriter::flushStrip() {
+    int strip = (rowsTotal_ - 1) / header_.stripRows;
+    std::vector<uint8_t> packed;
+    for (size_t slot = 0; slot < strip_.size(); slot++) {
+        std::vector<uint8_t> &plane = strip_[slot];
+        const uint8_t *data = plane.data();
+        size_t size = plane.size();
+        if (header_.compression == RAW_ZLIB) {
+            uLongf packedSize = compressBound(size);
+            packed.resize(packedSize);
+            if (compress2(packed.data(), &packedSize, data, size, ZLIB_LEVEL) != Z_OK) return ok_ = false;
+            data = packed.data();
+            size = packedSize;
+        }
+        table_[(size_t)strip * strip_.size() + slot] = {offset_, size};
+        file_.write((const char *)data, size);
+        // Следующая плоскость — с границы 8 байт
+        size_t pad = (8 - size % 8) % 8;
+        static const char ZEROS[8] = {};
+        file_.write(ZEROS, pad);
+        offset_ += size + pad;
+        plane.clear();
+    }
+    rows_ = 0;
+    return ok_ = (bool)file_;
+}
+
+bool RawWriter::close() {
+    if (!ok_) return false;
+    if (rows_ > 0) flushStrip();
+    bool ok = ok_ && rowsTotal_ == (int)header_.height;
+    // Таблица, затем заголовок: до этого момента файл не опознаётся
+    file_.seekp(sizeof(RawHeader));
+    file_.write((const char *)table_.data(), table_.size() * sizeof(RawStripEntry));
+    file_.flush();
+    if (ok) {
+        file_.seekp(0);
+        file_.write((const char *)&header_, sizeof(header_));
+    }
+    file_.close();
+    ok_ = false;
+    return ok && !file_.fail();
+}
+
+// --- RawReader ---
+
+RawReader::~RawReader() {
+    if (map_) munmap((void *)map_, mapSize_);
+}
+
+bool RawReader::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(RawHeader);
+    void *map = ok ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    map_ = (const uint8_t *)map;
+    mapSize_ = st.st_size;
+
+    std::memcpy(&header_, map_, sizeof(header_));
+    if (std::memcmp(header_.magic, "MRAW", 4) != 0 || header_.version != 1 || header_.width == 0 ||
+        header_.height == 0 || header_.stripRows == 0 || !(header_.planes & RAW_ITER) ||
+        header_.compression > RAW_ZLIB || sizeof(RawHeader) + tableBytes(header_) > mapSize_)
+        return false;
+    table_ = (const RawStripEntry *)(map_ + sizeof(RawHeader));
+    // Данные будем читать построчно по порядку: ядру стоит читать вперёд
+    madvise((void *)map_, mapSize_, MADV_SEQUENTIAL);
+    return true;
+}
+
+int RawReader::stripRows(int strip) const {
+    int first = strip * header_.stripRows;
+    return std::min<int>(header_.stripRows, header_.height - first);
+}
+
+const void *RawReader::strip(int strip, RawPlane plane, std::vector<uint8_t> &scratch) const {
+    int slot = planeSlot(header_.planes, plane);
+    if (!map_ || slot < 0 || strip < 0 || strip >= header_.strips()) return nullptr;
+    const RawStripEntry &entry = table_[(size_t)strip * header_.planeCount() + slot];
+    if (entry.offset > mapSize_ || entry.size > mapSize_ - entry.offset) return nullptr;
+    size_t bytes = (size_t)stripRows(strip) * header_.width * VALUE_BYTES;
+    if (header_.compression == RAW_NONE) return entry.size == bytes ? map_ + entry.offset : nullptr;
+    scratch.resize(bytes);
+    uLongf size = bytes;
+    if (uncompress(scratch.data(), &size, map_ + entry.offset, entry.size) != Z_OK || size != bytes) return nullptr;
+    return scratch.data();
+}
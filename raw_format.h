@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// --- Сырые данные кадра (.mraw) для раскраски потом ---
+// Кадр считается один раз, а раскрашивается сколько угодно (recolor).
+// Раскладка файла (little-endian, всё выровнено на 8 байт):
+//   RawHeader;
+//   таблица полос: для каждой полосы и каждой плоскости из planes —
+//     RawStripEntry {offset, size};
+//   данные полос.
+// Полоса — stripRows строк во всю ширину (последняя может быть короче).
+// Строки идут сверху вниз, как в картинке. Плоскости полосы лежат подряд в
+// порядке ITER, SMOOTH, DISTANCE; ITER — uint32 на пиксель, остальные —
+// float. Без сжатия данные полосы читаются прямо из отображения файла,
+// с RAW_ZLIB каждая плоскость полосы сжата отдельно, и полосы разжимаются
+// независимо (параллельно и в любом порядке).
+// Заголовок пишется последним: файл, запись которого оборвалась, не
+// открывается.
+enum RawPlane { RAW_ITER = 1, RAW_SMOOTH = 2, RAW_DISTANCE = 4 };
+enum RawCompression { RAW_NONE = 0, RAW_ZLIB = 1 };
+
+struct RawHeader {
+    char magic[4] = {'M', 'R', 'A', 'W'};
+    uint32_t version = 1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t maxIter = 0;
+    uint32_t planes = RAW_ITER;  // маска RawPlane
+    uint32_t compression = RAW_NONE;
+    uint32_t stripRows = 64;
+    // Вид, с которого сняты данные (для справки и перерасчёта)
+    double centerX = 0;
+    double centerY = 0;
+    double zoom = 0;
+    uint8_t reserved[40] = {};
+
+    int strips() const { return (height + stripRows - 1) / stripRows; }
+    int planeCount() const;
+};
+static_assert(sizeof(RawHeader) == 96, "raw header layout is part of the file format");
+
+struct RawStripEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// --- Запись построчно ---
+// В памяти одна полоса; каждая полоса сжимается и пишется, как только
+// заполнится.
+class RawWriter {
+public:
+    bool open(const std::string &path, const RawHeader &header);
+    // Следующая строка (сверху вниз); плоскости, которых нет в planes,
+    // игнорируются (можно nullptr)
+    bool writeRow(const uint32_t *iter, const float *smooth, const float *distance);
+    // Дописать последнюю полосу, таблицу и заголовок; false, если строк
+    // меньше height или запись не удалась
+    bool close();
+
+private:
+    bool flushStrip();
+
+    std::ofstream file_;
+    RawHeader header_;
+    std::vector<RawStripEntry> table_;
+    std::vector<std::vector<uint8_t>> strip_;  // по плоскости
+    int rows_ = 0;       // строк в текущей полосе
+    int rowsTotal_ = 0;
+    uint64_t offset_ = 0;
+    bool ok_ = false;
+};
+
+// --- Чтение через mmap ---
+// Потокобезопасно: после open() объект только читается.
+class RawReader {
+public:
+    RawReader() = default;
+    ~RawReader();
+    RawReader(const RawReader &) = delete;
+    RawReader &operator=(const RawReader &) = delete;
+
+    bool open(const std::string &path);
+    const RawHeader &header() const { return header_; }
+    int stripRows(int strip) const;
+
+    // Плоскость полосы: stripRows(strip) * width значений. Без сжатия —
+    // указатель в отображение файла, иначе данные разжимаются в scratch.
+    // nullptr, если плоскости нет или данные повреждены.
+    const void *strip(int strip, RawPlane plane, std::vector<uint8_t> &scratch) const;
+
+private:
+    const uint8_t *map_ = nullptr;
+    size_t mapSize_ = 0;
+    RawHeader header_;
+    const RawStripEntry *table_ = nullptr;
+};
@@ -0,0 +1,183 @@
+// --- Раскраска сохранённых данных кадра (.mraw) в PNG ---
+// Использование: recolor файл.mraw [--out файл.png] [--color poly|hsv|smooth]
+//                        [--plane iter|smooth|distance] [--max-iter N]
+//                        [--level 0..9] [--threads N] [--equalize]
+// Итерации уже посчитаны (poster --out *.mraw), так что палитру можно
+// менять сколько угодно без перерасчёта. Раскраска — по таблице палитры,
+// полосы файла разжимаются и раскрашиваются параллельно, PNG сжимается
+// параллельно (PngWriter). --plane smooth (по умолчанию, если плоскость есть)
+// даёт раскраску без полос; --max-iter растягивает палитру на другой диапазон.
+// --plane distance (poster --distance) — серая шкала по расстоянию до
+// множества (distanceRow), палитра не нужна.
+// --equalize красит выравниванием гистограммы (histogram_color.h): первый
+// проход по полосам собирает гистограмму итераций, --color не нужен.
+#include "histogram_color.h"
+#include "palette.h"
+#include "png_writer.h"
+#include "raw_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string in;
+    std::string out = "recolor.png";
+    ColorMode colorMode = COLOR_POLY;
+    int plane = -1;  // RawPlane; -1 — smooth, если есть
+    int maxIter = 0;  // 0 — как в файле
+    int level = Z_DEFAULT_COMPRESSION;
+    int threads = 0;
+    bool equalize = false;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg[0] != '-' && options.in.empty()) {
+            options.in = arg;
+            continue;
+        }
+        if (std::strcmp(arg, "--equalize") == 0) {
+            options.equalize = true;
+            continue;
+        }
+        if (!value) return false;
+        if (std::strcmp(arg, "--out") == 0) {
+            options.out = value;
+        } else if (std::strcmp(arg, "--color") == 0) {
+            if (std::strcmp(value, "poly") == 0) options.colorMode = COLOR_POLY;
+            else if (std::strcmp(value, "hsv") == 0) options.colorMode = COLOR_HSV;
+            else if (std::strcmp(value, "smooth") == 0) options.colorMode = COLOR_SMOOTH;
+            else return false;
+        } else if (std::strcmp(arg, "--plane") == 0) {
+            if (std::strcmp(value, "iter") == 0) options.plane = RAW_ITER;
+            else if (std::strcmp(value, "smooth") == 0) options.plane = RAW_SMOOTH;
+            else if (std::strcmp(value, "distance") == 0) options.plane = RAW_DISTANCE;
+            else return false;
+        } else if (std::strcmp(arg, "--max-iter") == 0) {
+            options.maxIter = std::atoi(value);
+        } else if (std::strcmp(arg, "--level") == 0) {
+            options.level = std::atoi(value);
+            if (options.level < 0 || options.level > 9) return false;
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            options.threads = std::max(0, std::atoi(value));
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return !options.in.empty();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: recolor file.mraw [--out file.png] [--color poly|hsv|smooth]"
+                     " [--plane iter|smooth|distance] [--max-iter N] [--level 0..9] [--threads N] [--equalize]"
+                  << std::endl;
+        return 2;
+    }
+    RawReader raw;
+    if (!raw.open(options.in)) {
+        std::cerr << "cannot read " << options.in << std::endl;
+        return 1;
+    }
+    const RawHeader &header = raw.header();
+    if (options.plane < 0) options.plane = (header.planes & RAW_SMOOTH) ? RAW_SMOOTH : RAW_ITER;
+    if (!(header.planes & options.plane)) {
+        std::cerr << options.in << " has no such plane" << std::endl;
+        return 1;
+    }
+    int maxIter = options.maxIter > 0 ? options.maxIter : header.maxIter;
+    int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    auto start = std::chrono::steady_clock::now();
+    int strips = header.strips();
+    PaletteLut palette(maxIter, options.colorMode);
+    if (options.equalize) {
+        // Первый проход: гистограммы полос по потокам, затем слияние
+        std::vector<IterHistogram> partial(threads, IterHistogram(maxIter));
+        std::vector<char> partialOk(threads, 1);
+        auto countStrips = [&](int t) {
+            std::vector<uint8_t> scratch;
+            for (int strip = t; strip < strips; strip += threads) {
+                const void *data = raw.strip(strip, RAW_ITER, scratch);
+                if (!data) {
+                    partialOk[t] = 0;
+                    return;
+                }
+                partial[t].add((const uint32_t *)data, (size_t)raw.stripRows(strip) * header.width);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; t++) pool.emplace_back(countStrips, t);
+        countStrips(0);
+        for (std::thread &thread : pool) thread.join();
+        for (int t = 0; t < threads; t++) {
+            if (!partialOk[t]) {
+                std::cerr << options.in << " is damaged" << std::endl;
+                return 1;
+            }
+            if (t) partial[0].merge(partial[t]);
+        }
+        palette = PaletteLut(partial[0].palette());
+    }
+    PngWriter png;
+    if (!png.open(options.out, header.width, header.height, options.level, threads)) {
+        std::cerr << "cannot write " << options.out << std::endl;
+        return 1;
+    }
+
+    // Полосы идут пачками по threads: каждая раскрашивается своим потоком,
+    // потом пачка уходит в PNG по порядку
+    std::vector<std::vector<uint8_t>> rgb(threads), scratch(threads);
+    std::vector<char> stripOk(threads);
+    bool ok = true;
+    for (int first = 0; first < strips && ok; first += threads) {
+        int count = std::min(threads, strips - first);
+        auto colorStrip = [&](int k) {
+            int strip = first + k;
+            const void *data = raw.strip(strip, (RawPlane)options.plane, scratch[k]);
+            stripOk[k] = data != nullptr;
+            if (!data) return;
+            int rows = raw.stripRows(strip);
+            rgb[k].resize((size_t)rows * header.width * 3);
+            for (int r = 0; r < rows; r++) {
+                size_t offset = (size_t)r * header.width;
+                uint8_t *out = &rgb[k][offset * 3];
+                if (options.plane == RAW_DISTANCE)
+                    distanceRow((const float *)data + offset, header.width, out);
+                else if (options.plane == RAW_SMOOTH)
+                    palette.row((const float *)data + offset, header.width, out);
+                else
+                    palette.row((const uint32_t *)data + offset, header.width, out);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int k = 1; k < count; k++) pool.emplace_back(colorStrip, k);
+        colorStrip(0);
+        for (std::thread &thread : pool) thread.join();
+        for (int k = 0; k < count && ok; k++) {
+            ok = stripOk[k] && png.writeRows(rgb[k].data(), raw.stripRows(first + k));
+            if (!stripOk[k]) std::cerr << "strip " << first + k << " is damaged" << std::endl;
+        }
+    }
+    ok = png.close() && ok;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double pixels = (double)header.width * header.height;
+    std::fprintf(stderr, "%s: %ux%u in %.2f s, %.1f Mpix/s\n", ok ? options.out.c_str() : "FAILED", header.width,
+                 header.height, seconds, pixels / (seconds * 1e6));
+    return ok ? 0 : 1;
+}
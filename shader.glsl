@@ -127,12 +127,24 @@ bool greaterDouble(Double a, Double b) {
     return a.lo > b.lo;
 }
 
+// Порог |dz|^2, ниже которого точка считается притянутой к циклу (как
+// INTERIOR_EPS2 в ядре OpenCL)
+const float INTERIOR_EPS2 = 1e-6;
+
 int mandelbrot(Dvec2 c) {
   Dvec2 z = Dvec2(makeDouble(0.0), makeDouble(0.0));
   int iterations = 0;
+  // Производная dz_n/dz_1 (произведение 2*z по орбите): для неё хватает
+  // старших частей z, отсчёт — от первого шага, где z = c
+  vec2 dz = vec2(1.0, 0.0);
   
   for (int i = 0; i < u_maxIterations; i++) {
     if (greaterDouble(DDot(z, z), makeDouble(4.0))) break;
+    if (i > 0) {
+      dz = 2.0 * vec2(z.x.hi * dz.x - z.y.hi * dz.y, z.x.hi * dz.y + z.y.hi * dz.x);
+      // Внутри множества: дальше считать незачем, цвет тот же, что у maxIter
+      if (dot(dz, dz) < INTERIOR_EPS2) return u_maxIterations;
+    }
     // z = vec2(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y) + c;
     z = Dvec2(addDouble(mulDouble(z.x, z.x), negateDouble(mulDouble(z.y, z.y))), mulDouble(mulDouble(makeDouble(2.0), z.x), z.y));
     z = Dvec2(addDouble(c.x, z.x), addDouble(c.y, z.y));
@@ -0,0 +1,95 @@
+#include "tile_cache.h"
+#include "tile_store.h"
+#include <tuple>
+
+bool TileKey::operator<(const TileKey &other) const {
+    return std::tie(level, tx, ty, maxIter, precision, formula) <
+           std::tie(other.level, other.tx, other.ty, other.maxIter, other.precision, other.formula);
+}
+
+TileCache::TileCache(size_t budgetBytes) : budget_(budgetBytes) {}
+
+TileCache::Tile TileCache::find(const TileKey &key) {
+    std::shared_ptr<TileStore> store;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            hits_++;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+        misses_++;
+        // В записи индекса на диске формулы нет
+        if (key.formula == 0) store = store_;
+    }
+    // Диск читается без блокировки кэша
+    Tile tile = store ? store->load(key) : nullptr;
+    if (tile) insertMemory(key, tile);
+    return tile;
+}
+
+void TileCache::insert(const TileKey &key, Tile tile) {
+    insert({{key, tile}});
+}
+
+void TileCache::insert(const std::vector<std::pair<TileKey, Tile>> &tiles) {
+    for (auto &tile : tiles) insertMemory(tile.first, tile.second);
+    std::shared_ptr<TileStore> store;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        store = store_;
+    }
+    if (!store) return;
+    std::vector<std::pair<TileKey, Tile>> mandelbrot;
+    for (auto &tile : tiles)
+        if (tile.first.formula == 0) mandelbrot.push_back(tile);
+    if (!mandelbrot.empty()) store->store(mandelbrot);
+}
+
+void TileCache::setStore(std::shared_ptr<TileStore> store) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    store_ = std::move(store);
+}
+
+void TileCache::insertMemory(const TileKey &key, Tile tile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->second = tile;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.emplace_front(key, tile);
+    index_[key] = lru_.begin();
+    evict();
+}
+
+void TileCache::setBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budgetBytes;
+    evict();
+}
+
+size_t TileCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size() * TILE_BYTES;
+}
+
+uint64_t TileCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+uint64_t TileCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void TileCache::evict() {
+    // Вытесненные плитки, которые кто-то ещё держит, живут до конца его кадра
+    while (!lru_.empty() && lru_.size() * TILE_BYTES > budget_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "engine.h"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// --- Квадродерево плиток итераций ---
+// На уровне level плитка — квадрат со стороной TILE_BASE / 2^level,
+// TILE x TILE отсчётов с шагом side / TILE. Отсчёт (i, j) плитки (tx, ty)
+// лежит в точке ((tx*TILE + i) * step, (ty*TILE + j) * step), так что сетки
+// соседних плиток стыкуются, а плитка не зависит от того, какой вид её
+// запросил.
+const double TILE_BASE = 4.0;
+
+struct TileKey {
+    int level = 0;
+    int64_t tx = 0;
+    int64_t ty = 0;
+    int maxIter = 0;
+    Precision precision = PRECISION_DOUBLE;
+    uint64_t formula = 0;  // formulaKey: 0 — Mandelbrot
+
+    bool operator<(const TileKey &other) const;
+};
+
+class TileStore;
+
+// --- Кэш плиток в памяти с вытеснением давно не использованных ---
+// Потокобезопасен: плитки может делить несколько вычислителей и потоков.
+// Если задано хранилище на диске, промахи ищутся в нём, а новые плитки
+// дописываются туда же; формата хранилища хватает только на плитки
+// Mandelbrot, плитки других формул живут лишь в памяти.
+class TileCache {
+public:
+    static const int TILE = 64;
+    static const size_t TILE_BYTES = TILE * TILE * sizeof(uint32_t);
+
+    using Tile = std::shared_ptr<const std::vector<uint32_t>>;
+
+    explicit TileCache(size_t budgetBytes);
+
+    // Плитка или nullptr; найденная становится самой свежей
+    Tile find(const TileKey &key);
+    // Добавить (или заменить) плитку из TILE x TILE отсчётов, при превышении
+    // бюджета вытеснить старые
+    void insert(const TileKey &key, Tile tile);
+    // То же для пачки (в хранилище — одной записью)
+    void insert(const std::vector<std::pair<TileKey, Tile>> &tiles);
+
+    void setStore(std::shared_ptr<TileStore> store);
+    void setBudget(size_t budgetBytes);
+    size_t bytes() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    void insertMemory(const TileKey &key, Tile tile);
+    void evict();
+
+    mutable std::mutex mutex_;
+    size_t budget_;
+    // Список от свежих к старым; map указывает на элемент списка
+    std::list<std::pair<TileKey, Tile>> lru_;
+    std::map<TileKey, std::list<std::pair<TileKey, Tile>>::iterator> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    std::shared_ptr<TileStore> store_;
+};
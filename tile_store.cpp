@@ -0,0 +1,326 @@
+#include "tile_store.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+const uint32_t ENTRY_MAGIC = 0x4C49544D;  // "MTIL"
+// Уплотнять при открытии, если мусора больше, чем живых плиток, и файл не мал
+const uint64_t COMPACT_MIN_BYTES = 64ull << 20;
+
+struct IndexEntry {
+    int32_t level;
+    int32_t maxIter;
+    int64_t tx;
+    int64_t ty;
+    uint64_t offset;
+    int32_t precision;
+    uint32_t dataCrc;
+    uint32_t magic;
+    uint32_t entryCrc;  // crc32 всех полей выше
+};
+static_assert(sizeof(IndexEntry) == 48, "index entry layout is part of the file format");
+
+uint32_t crc(const void *data, size_t size) {
+    return (uint32_t)crc32(0, (const Bytef *)data, (uInt)size);
+}
+
+uint32_t entryCrc(const IndexEntry &entry) {
+    return crc(&entry, offsetof(IndexEntry, entryCrc));
+}
+
+bool validEntry(const IndexEntry &entry) {
+    return entry.magic == ENTRY_MAGIC && entry.entryCrc == entryCrc(entry);
+}
+
+uint64_t fileSize(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+uint64_t pathInode(const std::filesystem::path &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_ino : 0;
+}
+
+uint64_t fdInode(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? (uint64_t)st.st_ino : 0;
+}
+
+bool writeAll(int fd, const void *data, size_t size, uint64_t offset) {
+    const char *bytes = (const char *)data;
+    while (size > 0) {
+        ssize_t written = pwrite(fd, bytes, size, (off_t)offset);
+        if (written <= 0) return false;
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::filesystem::path TileStore::defaultDir() {
+    const char *xdg = std::getenv("XDG_CACHE_HOME");
+    const char *home = std::getenv("HOME");
+    std::filesystem::path dir = (xdg && *xdg) ? std::filesystem::path(xdg)
+                                : home       ? std::filesystem::path(home) / ".cache"
+                                             : std::filesystem::path(".");
+    return dir / "mandelbrot" / "tiles";
+}
+
+TileStore::TileStore(const std::filesystem::path &dir) : dir_(dir) {
+    bool wasteful = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open()) return;
+        uint64_t live = index_.size() * TileCache::TILE_BYTES;
+        uint64_t total = fileSize(dataFd_);
+        wasteful = total > COMPACT_MIN_BYTES && total - live > live;
+    }
+    if (wasteful) compact();
+}
+
+TileStore::~TileStore() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close();
+}
+
+bool TileStore::open() {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    dataFd_ = ::open((dir_ / "tiles.dat").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    indexFd_ = ::open((dir_ / "tiles.idx").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (!ready()) {
+        std::cerr << "tile store: cannot open " << dir_ << std::endl;
+        close();
+        return false;
+    }
+    indexInode_ = fdInode(indexFd_);
+    indexRead_ = 0;
+    entries_ = 0;
+    index_.clear();
+
+    // Оборванный хвост индекса отрезаем, иначе следующие записи встанут
+    // после мусора. Под блокировкой: другой процесс может как раз дописывать
+    flock(indexFd_, LOCK_EX);
+    refresh();
+    if (fileSize(indexFd_) > indexRead_) ftruncate(indexFd_, (off_t)indexRead_);
+    flock(indexFd_, LOCK_UN);
+    return true;
+}
+
+void TileStore::close() {
+    if (map_) munmap((void *)map_, mapSize_);
+    map_ = nullptr;
+    mapSize_ = 0;
+    if (dataFd_ >= 0) ::close(dataFd_);
+    if (indexFd_ >= 0) ::close(indexFd_);
+    dataFd_ = indexFd_ = -1;
+}
+
+void TileStore::refresh() {
+    if (pathInode(dir_ / "tiles.idx") != indexInode_) {
+        // Уплотнение подменило файлы
+        close();
+        open();
+        return;
+    }
+    uint64_t size = fileSize(indexFd_);
+    if (size < indexRead_ + sizeof(IndexEntry)) return;
+    std::vector<IndexEntry> entries((size - indexRead_) / sizeof(IndexEntry));
+    ssize_t got = pread(indexFd_, entries.data(), entries.size() * sizeof(IndexEntry), (off_t)indexRead_);
+    size_t count = got > 0 ? (size_t)got / sizeof(IndexEntry) : 0;
+    for (size_t i = 0; i < count; i++) {
+        const IndexEntry &entry = entries[i];
+        // Недописанная (чужая или после сбоя) запись — дальше не читаем
+        if (!validEntry(entry)) break;
+        TileKey key;
+        key.level = entry.level;
+        key.tx = entry.tx;
+        key.ty = entry.ty;
+        key.maxIter = entry.maxIter;
+        key.precision = (Precision)entry.precision;
+        index_[key] = {entry.offset, entry.dataCrc, entries_++};
+        indexRead_ += sizeof(IndexEntry);
+    }
+}
+
+bool TileStore::mapData(uint64_t size) {
+    if (size <= mapSize_) return map_ != nullptr;
+    if (map_) munmap((void *)map_, mapSize_);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, dataFd_, 0);
+    map_ = map == MAP_FAILED ? nullptr : (const unsigned char *)map;
+    mapSize_ = map_ ? size : 0;
+    return map_ != nullptr;
+}
+
+TileCache::Tile TileStore::load(const TileKey &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready()) return nullptr;
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        refresh();
+        it = index_.find(key);
+    }
+    if (it == index_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    Location location = it->second;
+    // Плитка могла быть дописана после отображения файла
+    uint64_t end = location.offset + TileCache::TILE_BYTES;
+    if (end > mapSize_) mapData(fileSize(dataFd_));
+    if (end > mapSize_ || crc(map_ + location.offset, TileCache::TILE_BYTES) != location.crc) {
+        misses_++;
+        return nullptr;
+    }
+    auto samples = std::make_shared<std::vector<uint32_t>>((size_t)TileCache::TILE * TileCache::TILE);
+    std::memcpy(samples->data(), map_ + location.offset, TileCache::TILE_BYTES);
+    hits_++;
+    return samples;
+}
+
+bool TileStore::store(const std::vector<std::pair<TileKey, TileCache::Tile>> &tiles) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready() || tiles.empty()) return false;
+    // Блокировка берётся на открытый индекс; если его тем временем подменило
+    // уплотнение, переоткрываем и пробуем снова
+    while (true) {
+        flock(indexFd_, LOCK_EX);
+        if (pathInode(dir_ / "tiles.idx") == indexInode_) break;
+        flock(indexFd_, LOCK_UN);
+        close();
+        if (!open()) return false;
+    }
+
+    uint64_t offset = fileSize(dataFd_);
+    std::vector<IndexEntry> entries;
+    std::vector<uint32_t> data;
+    data.reserve(tiles.size() * TileCache::TILE * TileCache::TILE);
+    for (auto &tile : tiles) {
+        const TileKey &key = tile.first;
+        IndexEntry entry = {};
+        entry.level = key.level;
+        entry.maxIter = key.maxIter;
+        entry.tx = key.tx;
+        entry.ty = key.ty;
+        entry.offset = offset + data.size() * sizeof(uint32_t);
+        entry.precision = key.precision;
+        entry.dataCrc = crc(tile.second->data(), TileCache::TILE_BYTES);
+        entry.magic = ENTRY_MAGIC;
+        entry.entryCrc = entryCrc(entry);
+        entries.push_back(entry);
+        data.insert(data.end(), tile.second->begin(), tile.second->end());
+    }
+
+    // Сначала плитки на диск, потом ссылки на них
+    bool ok = writeAll(dataFd_, data.data(), data.size() * sizeof(uint32_t), offset) && fdatasync(dataFd_) == 0 &&
+              writeAll(indexFd_, entries.data(), entries.size() * sizeof(IndexEntry), fileSize(indexFd_));
+    if (ok) refresh();
+    flock(indexFd_, LOCK_UN);
+    return ok;
+}
+
+bool TileStore::compact(uint64_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready()) return false;
+    while (true) {
+        flock(indexFd_, LOCK_EX);
+        if (pathInode(dir_ / "tiles.idx") == indexInode_) break;
+        flock(indexFd_, LOCK_UN);
+        close();
+        if (!open()) return false;
+    }
+    refresh();
+    mapData(fileSize(dataFd_));
+
+    // Самые свежие записи — первыми
+    std::vector<std::pair<TileKey, Location>> live(index_.begin(), index_.end());
+    std::sort(live.begin(), live.end(), [](auto &a, auto &b) { return a.second.order > b.second.order; });
+    if (maxBytes > 0 && live.size() * TileCache::TILE_BYTES > maxBytes)
+        live.resize(maxBytes / TileCache::TILE_BYTES);
+    std::reverse(live.begin(), live.end());
+
+    std::filesystem::path dataTmp = dir_ / "tiles.dat.tmp", indexTmp = dir_ / "tiles.idx.tmp";
+    int dataFd = ::open(dataTmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int indexFd = ::open(indexTmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = dataFd >= 0 && indexFd >= 0;
+    uint64_t offset = 0, indexOffset = 0;
+    for (size_t i = 0; ok && i < live.size(); i++) {
+        const TileKey &key = live[i].first;
+        const Location &location = live[i].second;
+        if (location.offset + TileCache::TILE_BYTES > mapSize_) continue;
+        const unsigned char *samples = map_ + location.offset;
+        if (crc(samples, TileCache::TILE_BYTES) != location.crc) continue;
+        IndexEntry entry = {};
+        entry.level = key.level;
+        entry.maxIter = key.maxIter;
+        entry.tx = key.tx;
+        entry.ty = key.ty;
+        entry.offset = offset;
+        entry.precision = key.precision;
+        entry.dataCrc = location.crc;
+        entry.magic = ENTRY_MAGIC;
+        entry.entryCrc = entryCrc(entry);
+        ok = writeAll(dataFd, samples, TileCache::TILE_BYTES, offset) &&
+             writeAll(indexFd, &entry, sizeof(entry), indexOffset);
+        offset += TileCache::TILE_BYTES;
+        indexOffset += sizeof(entry);
+    }
+    ok = ok && fsync(dataFd) == 0 && fsync(indexFd) == 0;
+    if (dataFd >= 0) ::close(dataFd);
+    if (indexFd >= 0) ::close(indexFd);
+
+    // Между двумя rename индекс может ссылаться на чужой файл данных —
+    // такие плитки не пройдут crc и будут посчитаны заново
+    std::error_code ec;
+    if (ok) std::filesystem::rename(dataTmp, dir_ / "tiles.dat", ec);
+    if (ok && !ec) std::filesystem::rename(indexTmp, dir_ / "tiles.idx", ec);
+    ok = ok && !ec;
+    if (!ok) {
+        std::filesystem::remove(dataTmp, ec);
+        std::filesystem::remove(indexTmp, ec);
+    }
+    // Закрытие старого индекса снимает блокировку
+    close();
+    open();
+    return ok;
+}
+
+uint64_t TileStore::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+uint64_t TileStore::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+size_t TileStore::tiles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+}
+
+uint64_t TileStore::dataBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dataFd_ >= 0 ? fileSize(dataFd_) : 0;
+}
+
+void printTileStoreStats(const TileStore &store) {
+    std::fprintf(stderr, "tile store: %zu tiles, %.1f MB on disk, %llu hits, %llu misses\n", store.tiles(),
+                 store.dataBytes() / 1048576.0, (unsigned long long)store.hits(), (unsigned long long)store.misses());
+}
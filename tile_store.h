@@ -0,0 +1,76 @@
+#pragma once
+#include "tile_cache.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+// --- Плитки на диске между запусками ---
+// Каталог с двумя файлами, оба только дописываются:
+//   tiles.dat — сырые плитки по TileCache::TILE_BYTES, читаются через mmap;
+//   tiles.idx — записи фиксированного размера: ключ, смещение в tiles.dat,
+//               crc32 плитки и crc32 самой записи.
+// Порядок записи: плитка, fdatasync, запись индекса. После сбоя в худшем
+// случае остаётся плитка без записи (её уберёт уплотнение) или оборванная
+// запись в конце индекса — она не проходит crc и отрезается при открытии.
+// Несколько процессов на одном узле делят каталог: дописывание идёт под
+// flock, чужие записи подхватываются при промахе, уплотнение подменяет
+// файлы через rename, и остальные процессы переоткрывают их.
+class TileStore {
+public:
+    // ~/.cache/mandelbrot/tiles (или $XDG_CACHE_HOME/mandelbrot/tiles)
+    static std::filesystem::path defaultDir();
+
+    explicit TileStore(const std::filesystem::path &dir);
+    ~TileStore();
+    TileStore(const TileStore &) = delete;
+    TileStore &operator=(const TileStore &) = delete;
+
+    // false, если каталог или файлы не удалось открыть
+    bool ready() const { return dataFd_ >= 0 && indexFd_ >= 0; }
+
+    // Плитка или nullptr (нет, либо не сошлась контрольная сумма)
+    TileCache::Tile load(const TileKey &key);
+    // Дописать пачку плиток: одна синхронизация диска на пачку
+    bool store(const std::vector<std::pair<TileKey, TileCache::Tile>> &tiles);
+
+    // Переписать живые плитки (последнюю версию каждого ключа) в новые
+    // файлы; если maxBytes > 0, оставить только самые свежие в этом объёме
+    bool compact(uint64_t maxBytes = 0);
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+    size_t tiles() const;
+    uint64_t dataBytes() const;
+
+private:
+    struct Location {
+        uint64_t offset;
+        uint32_t crc;
+        uint64_t order;  // номер записи в индексе: для "самых свежих"
+    };
+
+    bool open();
+    void close();
+    // Дочитать новые записи индекса (свои и чужие); переоткрыть файлы,
+    // если их подменило уплотнение
+    void refresh();
+    bool mapData(uint64_t size);
+
+    std::filesystem::path dir_;
+    mutable std::mutex mutex_;
+    int dataFd_ = -1;
+    int indexFd_ = -1;
+    uint64_t indexInode_ = 0;
+    uint64_t indexRead_ = 0;  // сколько байт индекса уже разобрано
+    const unsigned char *map_ = nullptr;
+    uint64_t mapSize_ = 0;
+    std::map<TileKey, Location> index_;
+    uint64_t entries_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+// Объём хранилища, попадания и промахи — строкой "tile store: ..." в stderr
+void printTileStoreStats(const TileStore &store);
@@ -0,0 +1,68 @@
+// --- Обслуживание хранилища плиток на диске ---
+// Использование: tilestore [--dir каталог] [--max-mb N]
+// Уплотняет хранилище (TileStore::compact): переписывает живые плитки в
+// новые файлы, выбрасывая заменённые версии и плитки без записи индекса.
+// С --max-mb оставляет только самые свежие плитки в этом объёме. Каталог
+// по умолчанию — TileStore::defaultDir(). Другие процессы могут работать с
+// хранилищем в это время: они переоткроют подменённые файлы.
+#include "tile_store.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+struct Options {
+    std::string dir;
+    uint64_t maxMb = 0;  // 0 — без ограничения объёма
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) return false;
+        if (std::strcmp(arg, "--dir") == 0) {
+            options.dir = value;
+        } else if (std::strcmp(arg, "--max-mb") == 0) {
+            options.maxMb = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: tilestore [--dir dir] [--max-mb N]" << std::endl;
+        return 2;
+    }
+    std::string dir = options.dir.empty() ? TileStore::defaultDir().string() : options.dir;
+    TileStore store(dir);
+    if (!store.ready()) {
+        std::cerr << "cannot open tile store " << dir << std::endl;
+        return 1;
+    }
+    std::fprintf(stderr, "%s: %zu tiles, %.1f MB on disk\n", dir.c_str(), store.tiles(),
+                 store.dataBytes() / 1048576.0);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = store.compact(options.maxMb << 20);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        std::cerr << "compaction failed" << std::endl;
+        return 1;
+    }
+    std::fprintf(stderr, "compacted in %.1f s: %zu tiles, %.1f MB on disk\n", seconds, store.tiles(),
+                 store.dataBytes() / 1048576.0);
+    return 0;
+}
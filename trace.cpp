@@ -0,0 +1,165 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    const char *track;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Кольцевой буфер одного потока. Пишет только владелец; читатель (traceDump)
+// берёт снимок и отбрасывает записи, которые могли быть затёрты во время копирования.
+struct TraceBuffer {
+    static const size_t CAPACITY = 1 << 16;
+    TraceEvent events[CAPACITY];
+    std::atomic<uint64_t> written{0};
+    std::atomic<const char *> threadName{nullptr};
+    int tid = 0;
+};
+
+std::atomic<bool> enabledFlag{false};
+std::mutex registryMutex;
+// Все буферы (для traceDump) и свободные — от завершившихся потоков. Новый
+// поток берёт свободный, так что буферов не больше, чем потоков, живших
+// одновременно: пул, пересоздаваемый на каждый кадр, память не копит.
+// Дорожка в трассе — буфер, а не поток: события завершившегося потока
+// остаются на ней под именем следующего владельца.
+std::vector<std::unique_ptr<TraceBuffer>> registry;
+std::vector<TraceBuffer *> freeBuffers;
+
+// Буфер потока; при завершении потока возвращается в freeBuffers
+struct BufferOwner {
+    TraceBuffer *buffer = nullptr;
+    const char *threadName = nullptr;  // traceSetThreadName до появления буфера
+
+    ~BufferOwner() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        freeBuffers.push_back(buffer);
+    }
+};
+
+thread_local BufferOwner owner;
+
+TraceBuffer &threadBuffer() {
+    if (!owner.buffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (!freeBuffers.empty()) {
+            owner.buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        } else {
+            registry.push_back(std::make_unique<TraceBuffer>());
+            owner.buffer = registry.back().get();
+            owner.buffer->tid = (int)registry.size();
+        }
+        owner.buffer->threadName.store(owner.threadName, std::memory_order_relaxed);
+    }
+    return *owner.buffer;
+}
+
+void writeEscaped(std::ostream &out, const char *text) {
+    out << '"';
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+void writeThreadName(std::ostream &out, int tid, const char *name, bool &first) {
+    out << (first ? "\n" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << tid
+        << R"(,"args":{"name":)";
+    writeEscaped(out, name);
+    out << "}}";
+    first = false;
+}
+
+}  // namespace
+
+uint64_t traceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void traceRecord(const char *name, uint64_t startNs, uint64_t endNs, const char *track) {
+    if (!enabledFlag.load(std::memory_order_relaxed)) return;
+    TraceBuffer &buffer = threadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index % TraceBuffer::CAPACITY] = {name, track, startNs, endNs};
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void traceSetThreadName(const char *name) {
+    // Буфер заводится только при первой записи: без трассировки потоки его не получают
+    owner.threadName = name;
+    if (owner.buffer) owner.buffer->threadName.store(name, std::memory_order_relaxed);
+}
+
+void traceSetEnabled(bool enabled) {
+    enabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+bool traceEnabled() {
+    return enabledFlag.load(std::memory_order_relaxed);
+}
+
+bool traceDump(const std::string &path) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    std::vector<TraceBuffer *> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto &buffer : registry) buffers.push_back(buffer.get());
+    }
+
+    // Виртуальные дорожки получают tid после всех потоков
+    std::map<const char *, int> tracks;
+    int nextTrackTid = (int)buffers.size() + 1;
+
+    out << std::fixed << std::setprecision(3);
+    out << R"({"displayTimeUnit":"ms","traceEvents":[)";
+    bool first = true;
+    for (TraceBuffer *buffer : buffers) {
+        uint64_t end = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = end > TraceBuffer::CAPACITY ? end - TraceBuffer::CAPACITY : 0;
+        std::vector<TraceEvent> events;
+        events.reserve(end - begin);
+        for (uint64_t i = begin; i < end; i++) events.push_back(buffer->events[i % TraceBuffer::CAPACITY]);
+        // Пока копировали, владелец мог затереть самые старые записи
+        uint64_t after = buffer->written.load(std::memory_order_acquire);
+        size_t skip = after > begin + TraceBuffer::CAPACITY ? (size_t)(after - begin - TraceBuffer::CAPACITY) : 0;
+
+        const char *threadName = buffer->threadName.load(std::memory_order_relaxed);
+        writeThreadName(out, buffer->tid, threadName ? threadName : "thread", first);
+        for (size_t i = std::min(skip, events.size()); i < events.size(); i++) {
+            const TraceEvent &event = events[i];
+            int tid = buffer->tid;
+            if (event.track) {
+                auto it = tracks.find(event.track);
+                if (it == tracks.end()) {
+                    it = tracks.emplace(event.track, nextTrackTid++).first;
+                    writeThreadName(out, it->second, event.track, first);
+                }
+                tid = it->second;
+            }
+            out << ",\n{\"name\":";
+            writeEscaped(out, event.name);
+            out << R"(,"ph":"X","pid":1,"tid":)" << tid << R"(,"ts":)" << event.start / 1000.0 << R"(,"dur":)"
+                << (event.end - event.start) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// --- Трассировка этапов в формате Chrome trace (chrome://tracing, Perfetto) ---
+// Каждый поток пишет интервалы в свой кольцевой буфер без блокировок (старые
+// события затираются), traceDump() собирает все буферы в один JSON. Имена
+// событий и дорожек — строковые литералы: хранится только указатель.
+// По умолчанию трассировка выключена (traceSetEnabled): буфер потока
+// занимает пару мегабайт и заводится только при первой записи.
+
+// Монотонное время в наносекундах
+uint64_t traceNow();
+
+// Интервал [startNs, endNs) текущего потока. Если track задан, событие
+// попадает на отдельную "виртуальную" дорожку с этим именем (например,
+// очередь OpenCL), а не на дорожку потока.
+void traceRecord(const char *name, uint64_t startNs, uint64_t endNs, const char *track = nullptr);
+
+// Имя дорожки текущего потока в трассе
+void traceSetThreadName(const char *name);
+
+void traceSetEnabled(bool enabled);
+bool traceEnabled();
+
+// Записать все буферы в файл; false при ошибке записи
+bool traceDump(const std::string &path);
+
+// --- Интервал на время жизни объекта ---
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name) : name_(name), start_(traceEnabled() ? traceNow() : 0) {}
+    ~TraceSpan() {
+        if (start_) traceRecord(name_, start_, traceNow());
+    }
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_;
+    uint64_t start_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
@@ -0,0 +1,23 @@
+#pragma once
+
+// Шаг пикселя (zoom / height), начиная с которого итерациям хватает float
+const double FLOAT_SCALE_LIMIT = 1e-5;
+
+// --- Область комплексной плоскости и размер кадра ---
+// Пиксель (x, y) соответствует точке
+//   centerX + (x - width/2) * zoom/height, centerY + (y - height/2) * zoom/height,
+// то есть zoom — высота видимой области.
+struct View {
+    double centerX = -0.5;
+    double centerY = 0.0;
+    double zoom = 2.0;
+    int width = 800;
+    int height = 600;
+    int maxIter = 500;
+
+    bool operator==(const View &other) const {
+        return centerX == other.centerX && centerY == other.centerY && zoom == other.zoom && width == other.width &&
+               height == other.height && maxIter == other.maxIter;
+    }
+    bool operator!=(const View &other) const { return !(*this == other); }
+};
@@ -0,0 +1,41 @@
+#include "views.h"
+#include <cstring>
+
+namespace {
+
+View makeView(double centerX, double centerY, double zoom, int maxIter) {
+    View view;
+    view.centerX = centerX;
+    view.centerY = centerY;
+    view.zoom = zoom;
+    view.maxIter = maxIter;
+    return view;
+}
+
+// Ядро миниброта периода 936 в долине морских коньков (размер ~7.6e-9),
+// найдено методом Ньютона
+const double MINIBROT_X = -0.74364390138939727334;
+const double MINIBROT_Y = 0.13182587743631070989;
+
+}  // namespace
+
+const std::vector<NamedView> &canonicalViews() {
+    static const std::vector<NamedView> views = {
+        {"full", makeView(-0.5, 0.0, 2.0, 500)},
+        {"seahorse", makeView(-0.743643887037151, 0.131825904205330, 0.01, 1000)},
+        {"elephant", makeView(0.2925, 0.015, 0.01, 1000)},
+        {"minibrot-1e-3", makeView(MINIBROT_X, MINIBROT_Y, 1e-3, 1500)},
+        {"minibrot-1e-6", makeView(MINIBROT_X, MINIBROT_Y, 1e-6, 3000)},
+        {"minibrot-3e-8", makeView(MINIBROT_X, MINIBROT_Y, 3e-8, 5000)},
+        // Почти целиком внутри компоненты периода 3: ранний выход по
+        // кардиоиде не срабатывает, каждый пиксель считается до maxIter
+        {"interior", makeView(-0.1226, 0.7449, 0.1, 10000)},
+    };
+    return views;
+}
+
+const NamedView *findView(const char *name) {
+    for (const NamedView &view : canonicalViews())
+        if (std::strcmp(view.name, name) == 0) return &view;
+    return nullptr;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "view.h"
+#include <vector>
+
+// --- Эталонные виды для бенчмарка и тестов ---
+// Размер кадра (width/height) у эталонных видов — по умолчанию, вызывающий
+// код подставляет свой.
+struct NamedView {
+    const char *name;
+    View view;
+};
+
+const std::vector<NamedView> &canonicalViews();
+
+// Вид по имени; nullptr, если такого нет
+const NamedView *findView(const char *name);
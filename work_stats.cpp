@@ -0,0 +1,39 @@
+#include "work_stats.h"
+#include <algorithm>
+
+namespace {
+
+const double AUTO_STEP = 1.25;
+// Доля пикселей, убежавших в верхней четверти диапазона, при которой предел растёт
+const double RAISE_FRACTION = 1e-3;
+// Доля убежавших в верхней половине, ниже которой предел снижается. После
+// шага в любую сторону ни одно из условий не выполняется: верхняя четверть
+// нового диапазона лежит в верхней половине старого и наоборот
+const double LOWER_FRACTION = 1e-4;
+// Если не убежал вообще никто, кадр либо целиком внутри множества, либо
+// глубже предела; различить нельзя, поэтому растём, но не выше этого
+const int BLIND_LIMIT = 1 << 14;
+
+}  // namespace
+
+int autoMaxIter(const WorkStats &stats) {
+    int maxIter = stats.maxIter;
+    uint64_t pixels = stats.pixels();
+    if (pixels == 0 || maxIter < WorkStats::HISTOGRAM_BINS) return std::max(maxIter, AUTO_MAX_ITER_MIN);
+
+    // Последняя корзина содержит и дошедшие до предела — их вычитаем
+    const int bins = WorkStats::HISTOGRAM_BINS;
+    uint64_t topHalf = 0, topQuarter = 0;
+    for (int i = bins / 2; i < bins; i++) {
+        topHalf += stats.histogram[i];
+        if (i >= bins * 3 / 4) topQuarter += stats.histogram[i];
+    }
+    topHalf -= std::min(topHalf, stats.maxed);
+    topQuarter -= std::min(topQuarter, stats.maxed);
+
+    if (stats.escaped == 0 && stats.maxed > stats.skipped)
+        return std::max(maxIter, std::min((int)(maxIter * AUTO_STEP), BLIND_LIMIT));
+    if (topQuarter > RAISE_FRACTION * pixels) return std::min((int)(maxIter * AUTO_STEP), AUTO_MAX_ITER_LIMIT);
+    if (topHalf < LOWER_FRACTION * pixels) return std::max((int)(maxIter / AUTO_STEP), AUTO_MAX_ITER_MIN);
+    return maxIter;
+}
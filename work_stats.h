@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// --- Статистика работы за кадр ---
+// Мпикс/с у фрактала мало что говорят: цена пикселя зависит от вида.
+// Поэтому вычислители отчитываются о реально выполненных итерациях и о
+// пикселях, которые удалось не считать (ранний выход, кэш).
+struct WorkStats {
+    static const int HISTOGRAM_BINS = 64;
+
+    int maxIter = 0;          // с каким пределом считался кадр
+    uint64_t iterations = 0;  // выполнено итераций; пропущенные пиксели не в счёт
+    uint64_t escaped = 0;     // пиксели, убежавшие до maxIter
+    uint64_t maxed = 0;       // пиксели, дошедшие до maxIter (включая пропущенные)
+    uint64_t skipped = 0;     // пиксели без итераций: кардиоида/круг, кэш
+    uint64_t interior = 0;    // пиксели, остановленные до maxIter проверкой производной
+    // Число пикселей по корзинам числа итераций: [0, maxIter] делится на
+    // HISTOGRAM_BINS равных частей, последняя включает maxIter
+    std::vector<uint64_t> histogram = std::vector<uint64_t>(HISTOGRAM_BINS);
+
+    // Корзина гистограммы (та же формула, что в ядре при SPEC_STATS)
+    static int bin(uint32_t iter, int maxIter) { return (int)((uint64_t)iter * HISTOGRAM_BINS / (maxIter + 1)); }
+
+    void reset(int frameMaxIter) {
+        *this = WorkStats();
+        maxIter = frameMaxIter;
+    }
+
+    uint64_t pixels() const { return escaped + maxed; }
+
+    // Учесть пиксель; skipped — его итерации не выполнялись; interiorAt —
+    // на какой итерации его признала внутренним проверка производной (0 —
+    // не признала), iter при этом maxIter
+    void add(uint32_t iter, bool skippedPixel, uint32_t interiorAt = 0) {
+        if (!skippedPixel) iterations += interiorAt ? interiorAt : iter;
+        if (interiorAt) interior++;
+        if ((int)iter < maxIter) {
+            escaped++;
+        } else {
+            maxed++;
+        }
+        if (skippedPixel) skipped++;
+        histogram[bin(iter, maxIter)]++;
+    }
+
+    void merge(const WorkStats &other) {
+        iterations += other.iterations;
+        escaped += other.escaped;
+        maxed += other.maxed;
+        skipped += other.skipped;
+        interior += other.interior;
+        for (int i = 0; i < HISTOGRAM_BINS; i++) histogram[i] += other.histogram[i];
+    }
+};
+
+// --- Автоматический выбор maxIter по статистике прошлого кадра ---
+// Если заметная доля пикселей убегает у самого предела, он мал: картинка
+// ещё меняется, и maxIter растёт на шаг. Если же в верхней половине
+// диапазона никто не убегает, итерации тратятся впустую на внутренность
+// множества — maxIter снижается. Шаг — в 1.25 раза, пороги разнесены,
+// поэтому значение быстро устанавливается, не колеблется и не дёргает кэш
+// специализированных ядер.
+const int AUTO_MAX_ITER_MIN = 64;
+const int AUTO_MAX_ITER_LIMIT = 1 << 24;  // только защита от переполнения
+
+// Предел для следующего кадра по статистике кадра, посчитанного с stats.maxIter
+int autoMaxIter(const WorkStats &stats);
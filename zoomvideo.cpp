@@ -0,0 +1,288 @@
+// --- Видео погружения: ключевые кадры через 2x и кадры между ними ---
+// Использование: zoomvideo [--size WxH] [--view имя] [--center X,Y]
+//                          [--zoom-start Z] [--zoom-end Z] [--fps N]
+//                          [--octave-seconds S] [--max-iter N]
+//                          [--engine подстрока] [--color poly|hsv|smooth]
+//                          [--level 0..9] [--out каталог] [--cache-mb N]
+//                          [--tile-store каталог] [--formula формула]
+// Масштаб кадров меняется экспоненциально: за octave-seconds секунд вдвое.
+// Каждый кадр от Z до Z/2 — центральная часть одного ключевого кадра с
+// zoom = Z в удвоенном разрешении (2W x 2H): на выходной пиксель всегда
+// приходится от одного до двух пикселей ключевого кадра по каждой оси, так
+// что билинейная выборка не теряет деталей. Вместо fps * octave-seconds
+// полных расчётов на октаву — один (в 4 раза больше пикселей); следующий
+// ключевой кадр считается в фоне, пока из текущего собираются кадры.
+// Кадры пишутся в каталог как frame_000000.png, ...
+// --formula — формула итераций (formula.h): mandelbrot (по умолчанию),
+// julia:X,Y, multibrot:N или burning-ship.
+// --cache-mb — ключевые кадры через кэш плиток на N МБ (CachedEngine).
+// Соседние ключевые кадры плиток не делят (шаг сетки вдвое меньше), так
+// что кэш окупается вместе с --tile-store: плитки сохраняются на диск
+// (TileStore), и повторный прогон того же погружения (с другими fps или
+// длительностью) берёт их оттуда. Кэш хранит только итерации, поэтому
+// без --color smooth.
+#include "cached_engine.h"
+#include "engine.h"
+#include "formula.h"
+#include "palette.h"
+#include "png_writer.h"
+#include "tile_store.h"
+#include "trace.h"
+#include "views.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Во сколько раз ключевой кадр подробнее выходного по каждой оси
+const int KEYFRAME_SCALE = 2;
+
+struct Options {
+    int width = 1280;
+    int height = 720;
+    View view;
+    double zoomStart = 2.0;
+    double zoomEnd = 1e-6;
+    double fps = 60;
+    double octaveSeconds = 2.0;
+    int maxIter = 0;  // 0 — как у вида
+    std::string engineFilter;
+    ColorMode colorMode = COLOR_POLY;
+    int level = 1;  // кадров много, сжатие быстрое
+    std::string out = "frames";
+    size_t cacheMb = 0;  // 0 — без кэша плиток
+    std::string tileStore;
+    Formula formula;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) return false;
+        if (std::strcmp(arg, "--size") == 0) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2) return false;
+        } else if (std::strcmp(arg, "--view") == 0) {
+            const NamedView *named = findView(value);
+            if (!named) return false;
+            options.view = named->view;
+            options.zoomEnd = named->view.zoom;
+        } else if (std::strcmp(arg, "--center") == 0) {
+            if (std::sscanf(value, "%lf,%lf", &options.view.centerX, &options.view.centerY) != 2) return false;
+        } else if (std::strcmp(arg, "--zoom-start") == 0) {
+            options.zoomStart = std::atof(value);
+        } else if (std::strcmp(arg, "--zoom-end") == 0) {
+            options.zoomEnd = std::atof(value);
+        } else if (std::strcmp(arg, "--fps") == 0) {
+            options.fps = std::atof(value);
+        } else if (std::strcmp(arg, "--octave-seconds") == 0) {
+            options.octaveSeconds = std::atof(value);
+        } else if (std::strcmp(arg, "--max-iter") == 0) {
+            options.maxIter = std::atoi(value);
+        } else if (std::strcmp(arg, "--engine") == 0) {
+            options.engineFilter = value;
+        } else if (std::strcmp(arg, "--color") == 0) {
+            if (std::strcmp(value, "poly") == 0) options.colorMode = COLOR_POLY;
+            else if (std::strcmp(value, "hsv") == 0) options.colorMode = COLOR_HSV;
+            else if (std::strcmp(value, "smooth") == 0) options.colorMode = COLOR_SMOOTH;
+            else return false;
+        } else if (std::strcmp(arg, "--level") == 0) {
+            options.level = std::atoi(value);
+            if (options.level < 0 || options.level > 9) return false;
+        } else if (std::strcmp(arg, "--out") == 0) {
+            options.out = value;
+        } else if (std::strcmp(arg, "--cache-mb") == 0) {
+            options.cacheMb = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--tile-store") == 0) {
+            options.tileStore = value;
+        } else if (std::strcmp(arg, "--formula") == 0) {
+            if (!parseFormula(value, options.formula)) return false;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    if (options.maxIter > 0) options.view.maxIter = options.maxIter;
+    options.view.width = options.width;
+    options.view.height = options.height;
+    if (!options.tileStore.empty() && options.cacheMb == 0) return false;
+    if (options.cacheMb > 0 && options.colorMode == COLOR_SMOOTH) return false;
+    return options.width > 0 && options.height > 0 && options.zoomStart > 0 && options.zoomEnd > 0 &&
+           options.zoomEnd <= options.zoomStart && options.fps > 0 && options.octaveSeconds > 0;
+}
+
+// Ключевой кадр: вид и его раскраска (строки снизу вверх, как у вида)
+struct Keyframe {
+    View view;
+    std::vector<Rgb> rgb;
+    bool ok = false;
+    double renderMs = 0;
+};
+
+// Ключевой кадр на zoom с дробными итерациями и раскраской по палитре
+Keyframe renderKeyframe(Engine &engine, const View &base, double zoom, const PaletteLut &palette) {
+    TraceSpan span("keyframe");
+    auto start = std::chrono::steady_clock::now();
+    Keyframe key;
+    key.view = base;
+    key.view.zoom = zoom;
+    key.view.width = base.width * KEYFRAME_SCALE;
+    key.view.height = base.height * KEYFRAME_SCALE;
+    IterationBuffer buffer;
+    key.ok = engine.render(key.view, buffer);
+    if (key.ok) {
+        key.rgb.resize(buffer.iter.size());
+        for (int y = 0; y < buffer.height; y++) {
+            size_t offset = (size_t)y * buffer.width;
+            uint8_t *rgb = (uint8_t *)&key.rgb[offset];
+            if (buffer.smooth.empty()) palette.row(&buffer.iter[offset], buffer.width, rgb);
+            else palette.row(&buffer.smooth[offset], buffer.width, rgb);
+        }
+    }
+    key.renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return key;
+}
+
+// Кадр вида view из ключевого кадра с тем же центром и zoom не меньше:
+// билинейная выборка, строки результата сверху вниз (как в PNG)
+void synthesize(const Keyframe &key, const View &view, std::vector<uint8_t> &out) {
+    out.resize((size_t)view.width * view.height * 3);
+    const View &src = key.view;
+    double ratio = (view.zoom / view.height) / (src.zoom / src.height);
+    // Пиксель x кадра — точка ratio*x + offset ключевого кадра (как в resampleView)
+    double offsetX = src.width / 2.0 - ratio * view.width / 2.0;
+    double offsetY = src.height / 2.0 - ratio * view.height / 2.0;
+    std::vector<int> x0(view.width);
+    std::vector<float> fx(view.width);
+    for (int x = 0; x < view.width; x++) {
+        double u = std::min(std::max(ratio * x + offsetX, 0.0), src.width - 1.0);
+        x0[x] = std::min((int)u, src.width - 2);
+        fx[x] = (float)(u - x0[x]);
+    }
+    for (int r = 0; r < view.height; r++) {
+        int y = view.height - 1 - r;
+        double v = std::min(std::max(ratio * y + offsetY, 0.0), src.height - 1.0);
+        int y0 = std::min((int)v, src.height - 2);
+        float fy = (float)(v - y0);
+        const Rgb *row0 = &key.rgb[(size_t)y0 * src.width];
+        const Rgb *row1 = row0 + src.width;
+        uint8_t *dst = &out[(size_t)r * view.width * 3];
+        for (int x = 0; x < view.width; x++, dst += 3) {
+            const Rgb &a = row0[x0[x]], &b = row0[x0[x] + 1], &c = row1[x0[x]], &d = row1[x0[x] + 1];
+            float wa = (1 - fx[x]) * (1 - fy), wb = fx[x] * (1 - fy), wc = (1 - fx[x]) * fy, wd = fx[x] * fy;
+            dst[0] = (uint8_t)(a.r * wa + b.r * wb + c.r * wc + d.r * wd + 0.5f);
+            dst[1] = (uint8_t)(a.g * wa + b.g * wb + c.g * wc + d.g * wd + 0.5f);
+            dst[2] = (uint8_t)(a.b * wa + b.b * wb + c.b * wc + d.b * wd + 0.5f);
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: zoomvideo [--size WxH] [--view name] [--center X,Y] [--zoom-start Z] [--zoom-end Z]"
+                     " [--fps N] [--octave-seconds S] [--max-iter N] [--engine substr] [--color poly|hsv|smooth]"
+                     " [--level 0..9] [--out dir] [--cache-mb N] [--tile-store dir]"
+                     " [--formula mandelbrot|julia:X,Y|multibrot:N|burning-ship]"
+                  << std::endl;
+        return 2;
+    }
+    const View &view = options.view;
+    double framesPerOctave = options.fps * options.octaveSeconds;
+    int frames = (int)std::floor(std::log2(options.zoomStart / options.zoomEnd) * framesPerOctave) + 1;
+
+    // Самый глубокий ключевой кадр решает, хватит ли float
+    bool needDouble = options.zoomEnd / (view.height * KEYFRAME_SCALE) < FLOAT_SCALE_LIMIT;
+    std::unique_ptr<Engine> engine;
+    for (auto &candidate : createEngines()) {
+        if (candidate->name().find(options.engineFilter) == std::string::npos) continue;
+        if (needDouble && candidate->precision() != PRECISION_DOUBLE) continue;
+        engine = std::move(candidate);
+        break;
+    }
+    if (!engine) {
+        std::cerr << "no engine matches '" << options.engineFilter << "'" << std::endl;
+        return 1;
+    }
+    engine->setSmooth(true);
+    engine->setFormula(options.formula);
+    std::shared_ptr<TileStore> store;
+    if (!options.tileStore.empty()) {
+        store = std::make_shared<TileStore>(options.tileStore);
+        if (!store->ready()) {
+            std::cerr << "cannot open tile store " << options.tileStore << std::endl;
+            return 1;
+        }
+    }
+    std::shared_ptr<TileCache> cache;
+    if (options.cacheMb > 0) {
+        cache = std::make_shared<TileCache>(options.cacheMb << 20);
+        cache->setStore(store);
+        engine = std::make_unique<CachedEngine>(std::move(engine), cache);
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(options.out, ec);
+
+    std::fprintf(stderr, "%s, %s: %d frames %dx%d, %.0f frames per octave, keyframes %dx%d\n",
+                 engine->name().c_str(), formulaName(options.formula).c_str(), frames, view.width, view.height,
+                 framesPerOctave, view.width * KEYFRAME_SCALE, view.height * KEYFRAME_SCALE);
+
+    auto start = std::chrono::steady_clock::now();
+    PaletteLut palette(view.maxIter, options.colorMode);
+    // Ключевой кадр k — zoom = zoomStart / 2^k, покрывает кадры с zoom в (Z/2, Z]
+    auto keyZoom = [&](int k) { return options.zoomStart * std::exp2(-k); };
+    int lastKey = (int)std::floor((frames - 1) / framesPerOctave);
+    Keyframe key = renderKeyframe(*engine, view, keyZoom(0), palette);
+    std::future<Keyframe> next;
+    if (lastKey > 0)
+        next = std::async(std::launch::async, renderKeyframe, std::ref(*engine), view, keyZoom(1), std::cref(palette));
+    int keyIndex = 0, keyframes = 1;
+    double renderMs = key.renderMs;
+
+    std::vector<uint8_t> rgb;
+    bool ok = key.ok;
+    for (int frame = 0; frame < frames && ok; frame++) {
+        View frameView = view;
+        frameView.zoom = options.zoomStart * std::exp2(-frame / framesPerOctave);
+        int k = std::min((int)std::floor(frame / framesPerOctave), lastKey);
+        if (k != keyIndex) {
+            // Следующий ключевой кадр уже считался в фоне
+            key = next.get();
+            keyIndex = k;
+            keyframes++;
+            renderMs += key.renderMs;
+            ok = key.ok;
+            if (!ok) break;
+            if (k < lastKey)
+                next = std::async(std::launch::async, renderKeyframe, std::ref(*engine), view, keyZoom(k + 1),
+                                  std::cref(palette));
+        }
+        synthesize(key, frameView, rgb);
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06d.png", frame);
+        PngWriter png;
+        ok = png.open((std::filesystem::path(options.out) / name).string(), view.width, view.height, options.level) &&
+             png.writeRows(rgb.data(), view.height) && png.close();
+        if (frame % 10 == 0) std::fprintf(stderr, "\rframe %d/%d", frame + 1, frames);
+    }
+    if (next.valid()) next.wait();
+    if (!ok) std::cerr << "\nrender or write failed" << std::endl;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "\n%d frames from %d keyframes in %.1f s (keyframes %.1f s), %.1f frames/s\n", frames,
+                 keyframes, seconds, renderMs / 1e3, frames / seconds);
+    if (cache) printTileCacheStats(*cache);
+    if (store) printTileStoreStats(*store);
+    return ok ? 0 : 1;
+}